@@ -22,10 +22,21 @@ int main( int argc, char** argv )
     bool showImages = false;
     app.add_flag("-S,--show", showImages, "Display input and output images in new windows");
 
+    bool runLength = false;
+    app.add_flag("-R,--runLength", runLength, "Filter the run length encoding of the image");
+
+    int connectivity = 8;
+    app.add_option("-C,--connectivity", connectivity, "Connectivity of the components (8 by default, or 4)")->check(CLI::IsMember({4, 8}));
+
+    int verbosity = 0;
+    app.add_option("-V,--verbosity", verbosity, "Verbosity level of the diagnostics (0: none, 1: summary, 2: component sizes)");
+
     CLI11_PARSE(app, argc, argv);
+    setVerbosity(verbosity);
 
     Mat image = imreadHelper(inputImage);
-    Mat res_image = ccAreaFilter(image, areaThreshold);
+    Mat res_image = runLength ? RunLengthImage(image).areaFilter(areaThreshold, connectivity).toMat()
+                              : ccAreaFilter(image, areaThreshold, connectivity);
     imwriteHelper(res_image, outputImage);
 
     // maybe show result
@@ -20,22 +20,47 @@ int main( int argc, char** argv )
     bool showImages = false;
     app.add_flag("-S,--show", showImages, "Display input and output images in new windows");
 
+    bool runLength = false;
+    app.add_flag("-R,--runLength", runLength, "Label the run length encoding of the image");
+
+    int connectivity = 4;
+    app.add_option("-C,--connectivity", connectivity, "Connectivity of the components (4 or 8)")->check(CLI::IsMember({4, 8}));
+
+    bool rawLabels = false;
+    app.add_flag("-L,--labels", rawLabels, "Write the integer labels without normalization (16 bits PNG or 32 bits TIFF output)");
+
+    int verbosity = 0;
+    app.add_option("-V,--verbosity", verbosity, "Verbosity level of the diagnostics (0: none, 1: progress, 2: components)");
+
     CLI11_PARSE(app, argc, argv);
+    setVerbosity(verbosity);
 
-    cout << "Reading image: " << inputImage << endl;
+    if (verbosity >= 1)
+        cout << "Reading image: " << inputImage << endl;
     Mat image = imreadHelper(inputImage);
     if(image.empty()) {
         cerr << "Error: Could not read image " << inputImage << endl;
         return -1;
     }
-    cout << "Image read successfully. Size: " << image.size() << " Type: " << image.type() << endl;
 
-    cout << "Applying ccLabel..." << endl;
-    Mat res_image = ccLabel(image);
-    cout << "ccLabel done. Result size: " << res_image.size() << " Type: " << res_image.type() << endl;
+    // integer labels, remapped and normalized below
+    Mat labels;
+    int numberOfComponents;
+    if (runLength) {
+        RunLengthImage runs(image);
+        labels = runs.labelImage(runs.label(numberOfComponents, connectivity));
+    } else {
+        labels = ccLabelRaw(image, numberOfComponents, connectivity);
+    }
+
+    if (rawLabels) {
+        if (verbosity >= 1)
+            cout << "Writing labels: " << outputImage << endl;
+        imwriteLabels(labels, outputImage);
+        return 0;
+    }
 
-    cout << "Remapping labels..." << endl;
-    Mat tmp = remap_labels(res_image);
+    Mat tmp = remap_labels(labels);
     double min, max;
     cv::minMaxLoc(tmp, &min, &max);
 
@@ -46,23 +71,21 @@ int main( int argc, char** argv )
         cout << "Warning: a pixel has a label value greater than 255!" << endl;
     }
 
-    cout << "Converting to float..." << endl;
-    Mat tmp2;
-    res_image.convertTo(tmp2, CV_32FC1);
+    Mat tmp2, res_image;
+    labels.convertTo(tmp2, CV_32FC1);
     cv::normalize(tmp2, res_image, 0.0, 1.0, NORM_MINMAX, CV_32FC1);
     
-    cout << "Writing output image: " << outputImage << endl;
+    if (verbosity >= 1)
+        cout << "Writing output image: " << outputImage << endl;
     imwriteHelper(res_image, outputImage);
 
     // maybe show result
     if (showImages) {
-        cout << "Displaying images..." << endl;
         showimage(image, "Input Image");
         showimage(res_image, "Output Image");
         waitKey(0);
         destroyAllWindows();
     }
 
-    cout << "Done!" << endl;
     return 0;
 }
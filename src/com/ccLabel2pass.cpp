@@ -19,12 +19,33 @@ int main( int argc, char** argv )
     bool showImages = false;
     app.add_flag("-S,--show", showImages, "Display input and output images in new windows");
 
+    bool parallel = false;
+    app.add_flag("-P,--parallel", parallel, "Label horizontal strips of the image in parallel");
+
+    int connectivity = 4;
+    app.add_option("-C,--connectivity", connectivity, "Connectivity of the components (4 or 8)")->check(CLI::IsMember({4, 8}));
+
+    bool rawLabels = false;
+    app.add_flag("-L,--labels", rawLabels, "Write the integer labels without normalization (16 bits PNG or 32 bits TIFF output)");
+
+    int verbosity = 0;
+    app.add_option("-V,--verbosity", verbosity, "Verbosity level of the diagnostics (0: none, 1: progress)");
+
     CLI11_PARSE(app, argc, argv);
+    setVerbosity(verbosity);
 
     Mat image = imreadHelper(inputImage);
-    Mat res_image = ccTwoPassLabel(image);
+    int numberOfComponents;
+    Mat labels = parallel ? ccTwoPassLabelParallelRaw(image, numberOfComponents, connectivity)
+                          : ccTwoPassLabelRaw(image, numberOfComponents, connectivity);
+    if (verbosity >= 1)
+        cout << numberOfComponents << " components" << endl;
+    if (rawLabels) {
+        imwriteLabels(labels, outputImage);
+        return 0;
+    }
 
-    Mat tmp = remap_labels(res_image);
+    Mat tmp = remap_labels(labels);
     double min, max;
     cv::minMaxLoc(tmp, &min, &max);
 
@@ -35,8 +56,8 @@ int main( int argc, char** argv )
         cout << "Warning: a pixel has a label value greater than 255!";
     }
 
-    Mat tmp2;
-    res_image.convertTo(tmp2, CV_32FC1);
+    Mat tmp2, res_image;
+    labels.convertTo(tmp2, CV_32FC1);
     cv::normalize(tmp2, res_image, 0.0, 1.0, NORM_MINMAX, CV_32FC1);
     imwriteHelper(res_image, outputImage);
 
@@ -0,0 +1,64 @@
+#include "../common.h"
+#include "../tpConnectedComponents.h"
+#include "CLI11.hpp"
+
+using namespace cv;
+using namespace std;
+
+/**
+    Mean time in milliseconds of repetitions calls to label(image).
+*/
+template<typename Labeling>
+static double timeLabeling(Labeling label, const Mat& image, int repetitions)
+{
+    int64 start = getTickCount();
+    for (int r = 0; r < repetitions; r++) {
+        label(image);
+    }
+    return (getTickCount() - start) * 1000.0 / getTickFrequency() / repetitions;
+}
+
+int main( int argc, char** argv )
+{
+    CLI::App app{"Connected component labelling benchmark"};
+
+    string inputImage = "binary.png";
+    app.add_option("-I,--inputImage", inputImage, "Input image filename");
+
+    int tiles = 8;
+    app.add_option("-T,--tiles", tiles, "The input image is repeated tiles x tiles times");
+
+    int repetitions = 5;
+    app.add_option("-R,--repetitions", repetitions, "Number of runs of each measure");
+
+    int maxThreads = getNumberOfCPUs();
+    app.add_option("-M,--maxThreads", maxThreads, "Largest number of threads tested");
+
+    int connectivity = 4;
+    app.add_option("-C,--connectivity", connectivity, "Connectivity of the components (4 or 8)")->check(CLI::IsMember({4, 8}));
+
+    CLI11_PARSE(app, argc, argv);
+
+    Mat image = imreadHelper(inputImage, false);
+    image = repeat(image, tiles, tiles);
+    cout << "Image size: " << image.cols << "x" << image.rows << endl;
+
+    auto sequentialLabel = [connectivity](const Mat& image) { return ccTwoPassLabel(image, connectivity); };
+    auto parallelLabel = [connectivity](const Mat& image) { return ccTwoPassLabelParallel(image, connectivity); };
+
+    double sequential = timeLabeling(sequentialLabel, image, repetitions);
+    cout << "ccTwoPassLabel: " << sequential << " ms" << endl;
+
+    cout << "threads\tccTwoPassLabelParallel (ms)\tspeedup" << endl;
+    vector<int> threadCounts;
+    for (int threads = 1; threads < maxThreads; threads *= 2)
+        threadCounts.push_back(threads);
+    threadCounts.push_back(maxThreads);
+    for (int threads : threadCounts) {
+        setNumThreads(threads);
+        double parallel = timeLabeling(parallelLabel, image, repetitions);
+        cout << threads << "\t" << parallel << "\t" << sequential / parallel << endl;
+    }
+
+    return 0;
+}
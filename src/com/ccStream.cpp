@@ -0,0 +1,154 @@
+#include "../common.h"
+#include "../tpConnectedComponents.h"
+#include <fstream>
+#include <memory>
+#include "CLI11.hpp"
+
+using namespace cv;
+using namespace std;
+
+/**
+    Writes one line per component of stats: area, bounding box and centroid.
+*/
+static void writeComponents(ostream& out, const ComponentStats& stats)
+{
+    for (int l = 1; l <= stats.count; l++) {
+        out << stats.area[l] << "," << stats.left[l] << "," << stats.top[l] << ","
+            << stats.right[l] << "," << stats.bottom[l] << ","
+            << stats.centroidX(l) << "," << stats.centroidY(l) << "\n";
+    }
+}
+
+/**
+    Rebuilds the label image from the identifiers given by the streaming labeler, each component
+    being numbered in order of completion. Only for checking: the whole image is kept in memory.
+*/
+struct LabelRecorder
+{
+    Mat ids;
+    vector<int> parent, label;
+    int count;
+
+    LabelRecorder(int rows, int cols): ids(rows, cols, CV_32SC1, Scalar(0)), parent(1, 0), label(1, 0), count(0) {}
+
+    int find(int id)
+    {
+        while ((int)parent.size() <= id) {
+            parent.push_back((int)parent.size());
+            label.push_back(0);
+        }
+        while (parent[id] != id)
+            id = parent[id] = parent[parent[id]];
+        return id;
+    }
+
+    void record(const StreamingLabeler& labeler)
+    {
+        for (size_t k = 0; k < labeler.mergedIds().size(); k++) {
+            int merged = find(labeler.mergedIds()[k].first);
+            int into = find(labeler.mergedIds()[k].second);
+            parent[merged] = into;
+        }
+        for (size_t k = 0; k < labeler.finishedIds().size(); k++) {
+            int root = find(labeler.finishedIds()[k]);
+            label[root] = ++count;
+        }
+    }
+
+    Mat labels()
+    {
+        Mat res(ids.size(), CV_32FC1);
+        for (int i = 0; i < ids.rows; i++) {
+            for (int j = 0; j < ids.cols; j++) {
+                int id = ids.at<int>(i, j);
+                res.at<float>(i, j) = (float)(id ? label[find(id)] : 0);
+            }
+        }
+        normalize(res, res, 0, 1, NORM_MINMAX);
+        return res;
+    }
+};
+
+int main( int argc, char** argv )
+{
+    CLI::App app{"Streaming connected component labelling"};
+
+    string inputImage = "binary.png";
+    app.add_option("-I,--inputImage", inputImage, "Input image filename");
+
+    string outputFile = "components.csv";
+    app.add_option("-O,--outputFile", outputFile, "Output CSV file, one line per component in order of completion");
+
+    int stripRows = 0;
+    app.add_option("-R,--stripRows", stripRows, "Read a binary PGM input by strips of this number of rows");
+
+    int connectivity = 4;
+    app.add_option("-C,--connectivity", connectivity, "Connectivity of the components (4 or 8)")->check(CLI::IsMember({4, 8}));
+
+    string labelImage = "";
+    app.add_option("-L,--labelImage", labelImage, "Also write the label image rebuilt from the stream (normalized as ccLabel), for checking");
+
+    CLI11_PARSE(app, argc, argv);
+
+    ofstream out(outputFile);
+    if (!out) {
+        cerr << "Error: Could not open " << outputFile << endl;
+        return -1;
+    }
+    out << "area,left,top,right,bottom,centroidX,centroidY\n";
+
+    ComponentStats finished;
+    int numberOfComponents = 0;
+    Mat rowIds;
+    unique_ptr<LabelRecorder> recorder;
+    // labels the row and outputs the components it finished
+    auto push = [&](StreamingLabeler& labeler, Mat row) {
+        if (recorder) {
+            Mat target = recorder->ids.row(labeler.rowsRead());
+            labeler.pushRow(row, finished, rowIds);
+            rowIds.copyTo(target);
+            recorder->record(labeler);
+        } else {
+            labeler.pushRow(row, finished);
+        }
+        writeComponents(out, finished);
+        numberOfComponents += finished.count;
+    };
+    auto finish = [&](StreamingLabeler& labeler) {
+        labeler.finish(finished);
+        if (recorder)
+            recorder->record(labeler);
+        writeComponents(out, finished);
+        numberOfComponents += finished.count;
+    };
+
+    if (stripRows > 0) {
+        PgmStripReader reader(inputImage);
+        StreamingLabeler labeler(reader.cols(), connectivity);
+        if (!labelImage.empty())
+            recorder.reset(new LabelRecorder(reader.rows(), reader.cols()));
+        double scale = 1.0 / reader.maxVal();
+        Mat strip, row;
+        while (reader.read(strip, stripRows)) {
+            for (int i = 0; i < strip.rows; i++) {
+                strip.row(i).convertTo(row, CV_32F, scale);
+                push(labeler, row);
+            }
+        }
+        finish(labeler);
+    } else {
+        Mat image = imreadHelper(inputImage);
+        StreamingLabeler labeler(image.cols, connectivity);
+        if (!labelImage.empty())
+            recorder.reset(new LabelRecorder(image.rows, image.cols));
+        for (int i = 0; i < image.rows; i++)
+            push(labeler, image.row(i));
+        finish(labeler);
+    }
+
+    if (recorder)
+        imwriteHelper(recorder->labels(), labelImage);
+
+    cout << numberOfComponents << " components written to " << outputFile << endl;
+    return 0;
+}
@@ -19,10 +19,32 @@ int main( int argc, char** argv )
     bool showImages = false;
     app.add_flag("-S,--show", showImages, "Display input and output images in new windows");
 
+    int outputDepth = 0;
+    app.add_option("-D,--outputDepth", outputDepth, "Output bit depth: 8, 16 or 32 (float), 0 keeps the input depth");
+
     CLI11_PARSE(app, argc, argv);
 
-    Mat image = imreadHelper(inputImage, false);
-    Mat res_image = equalize(image);
+    int depth;
+    if(outputDepth == 0)
+        depth = -1;
+    else if(outputDepth == 8)
+        depth = CV_8U;
+    else if(outputDepth == 16)
+        depth = CV_16U;
+    else if(outputDepth == 32)
+        depth = CV_32F;
+    else
+    {
+        std::cerr << "Unsupported output depth:" << outputDepth << std::endl;
+        exit(1);
+    }
+
+    Mat image = imreadHelper(inputImage, false, true, true);
+    Mat res_image;
+    if(image.depth() == CV_8U && (depth == -1 || depth == CV_8U))
+        res_image = equalize(image);
+    else
+        res_image = equalizeHighDepth(image, depth);
     imwriteHelper(res_image, outputImage);
 
     // maybe show result
@@ -0,0 +1,44 @@
+
+#include "../common.h"
+#include "../tpHistogram.h"
+#include "CLI11.hpp"
+
+using namespace cv;
+using namespace std;
+
+int main( int argc, char** argv )
+{
+    CLI::App app{"Adaptive equalize"};
+
+    string inputImage = "camera_mauvaise_balance.png";
+    app.add_option("-I,--inputImage", inputImage, "Input image filename");
+
+    string outputImage = "out.png";
+    app.add_option("-O,--outputImage", outputImage, "Output image filename");
+
+    bool showImages = false;
+    app.add_flag("-S,--show", showImages, "Display input and output images in new windows");
+
+    int gridSize = 8;
+    app.add_option("-G,--gridSize", gridSize, "Number of tiles in each dimension");
+
+    float clipLimit = 2.0f;
+    app.add_option("-C,--clipLimit", clipLimit, "Histogram clip limit relative to the mean bin count (0 disables clipping)");
+
+    CLI11_PARSE(app, argc, argv);
+
+    Mat image = imreadHelper(inputImage, false);
+    Mat res_image = equalizeAdaptive(image, gridSize, clipLimit);
+    imwriteHelper(res_image, outputImage);
+
+    // maybe show result
+    if (showImages) {
+        showimage(image, "Input Image");
+        showimage(res_image, "Output Image");
+        waitKey(0);
+        destroyAllWindows();
+    }
+
+    return 0;
+}
+
@@ -0,0 +1,54 @@
+#include "../common.h"
+#include "../tpHistogram.h"
+#include "CLI11.hpp"
+
+using namespace cv;
+using namespace std;
+
+int main( int argc, char** argv )
+{
+    CLI::App app{"Equalize a sequence of frames"};
+
+    vector<string> inputImages;
+    app.add_option("-I,--inputImages", inputImages, "Input frame filenames, in sequence order")->required();
+
+    vector<string> outputImages;
+    app.add_option("-O,--outputImages", outputImages, "Output frame filenames, one per input frame")->required();
+
+    bool showImages = false;
+    app.add_flag("-S,--show", showImages, "Display input and output images in new windows");
+
+    int windowSize = 0;
+    app.add_option("-W,--windowSize", windowSize, "Number of frames of the sliding window histogram, 0 uses a decayed histogram");
+
+    float decay = 0.9f;
+    app.add_option("-D,--decay", decay, "Decay of the running histogram at each frame");
+
+    float tolerance = 0.005f;
+    app.add_option("-T,--tolerance", tolerance, "Cumulative distribution drift triggering a new lookup table");
+
+    CLI11_PARSE(app, argc, argv);
+
+    if (inputImages.size() != outputImages.size()) {
+        std::cerr << "The number of output images must match the number of input images" << std::endl;
+        exit(1);
+    }
+
+    RunningEqualizer equalizer = (windowSize > 0) ? RunningEqualizer::windowed(windowSize, tolerance)
+                                                  : RunningEqualizer::decayed(decay, tolerance);
+    for (size_t i = 0; i < inputImages.size(); i++) {
+        Mat image = imreadHelper(inputImages[i], false);
+        Mat res_image = equalizer.apply(image);
+        imwriteHelper(res_image, outputImages[i]);
+
+        // maybe show result
+        if (showImages) {
+            showimage(image, "Input Image");
+            showimage(res_image, "Output Image");
+            waitKey(0);
+            destroyAllWindows();
+        }
+    }
+
+    return 0;
+}
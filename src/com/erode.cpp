@@ -1,6 +1,7 @@
 
 #include "../common.h"
 #include "../tpMorphology.h"
+#include "../tpConnectedComponents.h"
 #include "CLI11.hpp"
 
 using namespace cv;
@@ -22,12 +23,24 @@ int main( int argc, char** argv )
     string structuringElement = "";
     app.add_option("-E,--structuringElement", structuringElement, "Structuring element filename")->required();
 
+    bool runLength = false;
+    app.add_flag("-R,--runLength", runLength, "Work on the run-length encoding of the image (rectangular structuring elements only)");
+
     CLI11_PARSE(app, argc, argv);
 
 
     Mat image = imreadHelper(inputImage);
     Mat se = imreadHelper(structuringElement);
-    Mat res_image = erode(image, se);
+    Mat res_image;
+    if (runLength) {
+        if (countNonZero(se) != (int)se.total()) {
+            std::cerr << "The run-length erode needs a rectangular structuring element" << std::endl;
+            exit(1);
+        }
+        res_image = RunLengthImage(image).erode(se.cols / 2, se.rows / 2).toMat();
+    }
+    else
+        res_image = erode(image, se);
     imwriteHelper(res_image, outputImage);
 
 
@@ -23,7 +23,7 @@ int main( int argc, char** argv )
     app.add_option("-F,--sizeFactor", sizeFactor, "Each dimension d of size sd is increased to size (sd-1)*sizeFactor")->required();
 
     string interpolation = "bilinear";
-    app.add_option("-P,--interpolation", interpolation, "Interpolation method ('nearest' or 'bilinear')");
+    app.add_option("-P,--interpolation", interpolation, "Interpolation method ('nearest', 'bilinear' or 'bicubic')");
 
     CLI11_PARSE(app, argc, argv);
 
@@ -32,6 +32,8 @@ int main( int argc, char** argv )
         interpolationMethod = interpolate_bilinear;
     else if(interpolation.compare("nearest")==0)
         interpolationMethod = interpolate_nearest;
+    else if(interpolation.compare("bicubic")==0)
+        interpolationMethod = interpolate_bicubic;
     else
     {
         std::cerr << "Interpolation method unknown:" << interpolation << std::endl;
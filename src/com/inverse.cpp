@@ -19,9 +19,12 @@ int main( int argc, char** argv )
     bool showImages = false;
     app.add_flag("-S,--show", showImages, "Display input and output images in new windows");
 
+    bool eightBits = false;
+    app.add_flag("-B,--eightBits", eightBits, "Process the unsigned char image (through a lookup table) instead of the float image");
+
     CLI11_PARSE(app, argc, argv);
 
-    Mat image = imreadHelper(inputImage);
+    Mat image = imreadHelper(inputImage, !eightBits);
     Mat res_image = inverse(image);
     imwriteHelper(res_image, outputImage);
 
@@ -0,0 +1,41 @@
+#include "../common.h"
+#include "../tpHistogram.h"
+#include "CLI11.hpp"
+
+using namespace cv;
+using namespace std;
+
+int main( int argc, char** argv )
+{
+    CLI::App app{"Histogram matching"};
+
+    string inputImage = "camera_mauvaise_balance.png";
+    app.add_option("-I,--inputImage", inputImage, "Input image filename");
+
+    string referenceImage = "camera.png";
+    app.add_option("-R,--referenceImage", referenceImage, "Reference image filename");
+
+    string outputImage = "out.png";
+    app.add_option("-O,--outputImage", outputImage, "Output image filename");
+
+    bool showImages = false;
+    app.add_flag("-S,--show", showImages, "Display input and output images in new windows");
+
+    CLI11_PARSE(app, argc, argv);
+
+    Mat image = imreadHelper(inputImage, false);
+    Mat reference = imreadHelper(referenceImage, false);
+    Mat res_image = matchHistogram(image, reference);
+    imwriteHelper(res_image, outputImage);
+
+    // maybe show result
+    if (showImages) {
+        showimage(image, "Input Image");
+        showimage(reference, "Reference Image");
+        showimage(res_image, "Output Image");
+        waitKey(0);
+        destroyAllWindows();
+    }
+
+    return 0;
+}
@@ -0,0 +1,47 @@
+#include "../common.h"
+#include "../tpConnectedComponents.h"
+#include "CLI11.hpp"
+
+using namespace cv;
+using namespace std;
+
+int main( int argc, char** argv )
+{
+    CLI::App app{"Grayscale attribute filter on the max-tree"};
+
+    string inputImage = "camera.png";
+    app.add_option("-I,--inputImage", inputImage, "Input image filename");
+
+    string outputImage = "out.png";
+    app.add_option("-O,--outputImage", outputImage, "Output image filename");
+
+    string attribute = "area";
+    app.add_option("-A,--attribute", attribute, "Attribute of the components: area, height or volume")->check(CLI::IsMember({"area", "height", "volume"}));
+
+    double threshold = 50;
+    app.add_option("-F,--threshold", threshold, "Components whose attribute is lower than threshold are removed")->required();
+
+    int connectivity = 4;
+    app.add_option("-C,--connectivity", connectivity, "Connectivity of the components (4 or 8)")->check(CLI::IsMember({4, 8}));
+
+    bool showImages = false;
+    app.add_flag("-S,--show", showImages, "Display input and output images in new windows");
+
+    CLI11_PARSE(app, argc, argv);
+
+    Mat image = imreadHelper(inputImage);
+    MaxTree::Attribute attributeType = (attribute == "height") ? MaxTree::Height
+                                     : (attribute == "volume") ? MaxTree::Volume : MaxTree::Area;
+    Mat res_image = MaxTree(image, connectivity).filter(attributeType, threshold);
+    imwriteHelper(res_image, outputImage);
+
+    // maybe show result
+    if (showImages) {
+        showimage(image, "Input Image");
+        showimage(res_image, "Output Image");
+        waitKey(0);
+        destroyAllWindows();
+    }
+
+    return 0;
+}
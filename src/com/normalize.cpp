@@ -19,8 +19,16 @@ int main( int argc, char** argv )
     bool showImages = false;
     app.add_flag("-S,--show", showImages, "Display input and output images in new windows");
 
+    int stripRows = 0;
+    app.add_option("-R,--stripRows", stripRows, "Process a binary PGM input by strips of this number of rows (output is PGM too)");
+
     CLI11_PARSE(app, argc, argv);
 
+    if (stripRows > 0) {
+        normalizeStreaming(inputImage, outputImage, stripRows);
+        return 0;
+    }
+
     Mat image = imreadHelper(inputImage);
     Mat res_image = normalize(image);
     imwriteHelper(res_image, outputImage);
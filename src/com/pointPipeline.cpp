@@ -0,0 +1,89 @@
+#include "../common.h"
+#include "../tpHistogram.h"
+#include "CLI11.hpp"
+#include <sstream>
+
+using namespace cv;
+using namespace std;
+
+/**
+    Splits text on the given separator.
+*/
+static vector<string> split(const string& text, char separator)
+{
+    vector<string> parts;
+    stringstream stream(text);
+    string part;
+    while (getline(stream, part, separator))
+        parts.push_back(part);
+    return parts;
+}
+
+int main( int argc, char** argv )
+{
+    CLI::App app{"Point operator pipeline"};
+
+    string inputImage = "cat.jpg";
+    app.add_option("-I,--inputImage", inputImage, "Input image filename");
+
+    string outputImage = "out.png";
+    app.add_option("-O,--outputImage", outputImage, "Output image filename");
+
+    bool showImages = false;
+    app.add_flag("-S,--show", showImages, "Display input and output images in new windows");
+
+    string stages;
+    app.add_option("-P,--pipeline", stages, "Comma separated stages: inverse, threshold:lowT:highT, quantize:levels, "
+                   "normalize:inputMin:inputMax:min:max, gamma:value")->required();
+
+    bool eightBits = false;
+    app.add_flag("-B,--eightBits", eightBits, "Process the unsigned char image (through a lookup table) instead of the float image");
+
+    bool inPlace = false;
+    app.add_flag("-N,--inPlace", inPlace, "Apply the pipeline in place on the input image");
+
+    CLI11_PARSE(app, argc, argv);
+
+    PointPipeline pipeline;
+    for (const string& stage : split(stages, ',')) {
+        vector<string> fields = split(stage, ':');
+        vector<float> args;
+        for (size_t i = 1; i < fields.size(); i++)
+            args.push_back(stof(fields[i]));
+
+        if (fields[0] == "inverse" && args.size() == 0) {
+            pipeline.inverse();
+        } else if (fields[0] == "threshold" && args.size() == 2) {
+            pipeline.threshold(args[0], args[1]);
+        } else if (fields[0] == "quantize" && args.size() == 1) {
+            pipeline.quantize((int)args[0]);
+        } else if (fields[0] == "normalize" && args.size() == 4) {
+            pipeline.normalize(args[0], args[1], args[2], args[3]);
+        } else if (fields[0] == "gamma" && args.size() == 1) {
+            pipeline.gamma(args[0]);
+        } else {
+            std::cerr << "Invalid pipeline stage: " << stage << std::endl;
+            exit(1);
+        }
+    }
+
+    Mat image = imreadHelper(inputImage, !eightBits);
+    Mat res_image;
+    if (inPlace) {
+        res_image = image.clone();
+        pipeline.applyInPlace(res_image);
+    } else {
+        res_image = pipeline.apply(image);
+    }
+    imwriteHelper(res_image, outputImage);
+
+    // maybe show result
+    if (showImages) {
+        showimage(image, "Input Image");
+        showimage(res_image, "Output Image");
+        waitKey(0);
+        destroyAllWindows();
+    }
+
+    return 0;
+}
@@ -22,9 +22,12 @@ int main( int argc, char** argv )
     int quantizeLevel = 3;
     app.add_option("-Q,--quantizeLevel", quantizeLevel, "Number of quantization levels")->required();
 
+    bool eightBits = false;
+    app.add_flag("-B,--eightBits", eightBits, "Process the unsigned char image (through a lookup table) instead of the float image");
+
     CLI11_PARSE(app, argc, argv);
 
-    Mat image = imreadHelper(inputImage);
+    Mat image = imreadHelper(inputImage, !eightBits);
     Mat res_image = quantize(image, quantizeLevel);
     imwriteHelper(res_image, outputImage);
 
@@ -143,6 +143,33 @@ bool compImBijection(Mat im1, Mat im2, string msg, bool show)
     return true;
 }
 
+bool compImExact(Mat im1, Mat im2, string msg, bool show)
+{
+    if(im1.cols != im2.cols || im1.rows != im2.rows || im1.channels() != im2.channels())
+    {
+        cerr << "\tDimensions or channel number incorrect, command:" << msg << endl;
+        return false;
+    }
+
+    im1.convertTo(im1, CV_64F);
+    im2.convertTo(im2, CV_64F);
+    Mat diff;
+    absdiff(im1.reshape(1), im2.reshape(1), diff);
+    int count = countNonZero(diff);
+    if(count != 0)
+    {
+        cerr <<  "\t" << count << " values differ, command: " << msg << endl;
+        if(show)
+        {
+            showimage(diff, msg.c_str());
+            waitKey(0);
+            destroyAllWindows();
+        }
+        return false;
+    }
+    return true;
+}
+
 bool exists_test (const std::string& name) {
   struct stat buffer;
   return (stat (name.c_str(), &buffer) == 0);
@@ -166,8 +193,9 @@ struct unittest{
     using fun_t = std::function<bool(Mat, Mat, string, bool)>;
     string commande;
     fun_t comparisonFunction;
+    string output; // file written by the command, out.png by default
 
-    unittest(string _commande, fun_t _comparisonFunction = compIm): commande(_commande), comparisonFunction(_comparisonFunction){
+    unittest(string _commande, fun_t _comparisonFunction = compIm, string _output = outname): commande(_commande), comparisonFunction(_comparisonFunction), output(_output){
 
     }
 };
@@ -182,6 +210,7 @@ void process(string name, vector<unittest> tests, bool record, bool show, bool m
         {
             auto com = t.commande;
             auto testFun = t.comparisonFunction;
+            auto output = t.output;
             c++;
             string refOutput = string("expected_results/") + string(name) + to_string(c) + string(".png");
 
@@ -213,7 +242,7 @@ void process(string name, vector<unittest> tests, bool record, bool show, bool m
                 break;
             }
 
-            if(!exists_test(outname))
+            if(!exists_test(output))
             {
                 cout << "\tOutput file does not exist, command: " << com << endl;
                 printFail();
@@ -222,7 +251,10 @@ void process(string name, vector<unittest> tests, bool record, bool show, bool m
 
             if(record)
             {
-                copyFile(outname, refOutput);
+                if(output == outname)
+                    copyFile(outname, refOutput);
+                else
+                    imwrite(refOutput, imread(output, IMREAD_UNCHANGED));
                 cout << KGRN << "\tok" << RST << endl;
             } else
             {
@@ -230,7 +262,7 @@ void process(string name, vector<unittest> tests, bool record, bool show, bool m
                 try
                 {
                     Mat refIm = imreadHelper(refOutput,false,false);
-                    Mat testIm = imreadHelper(outname,false,false);
+                    Mat testIm = imreadHelper(output,false,false);
                     r = testFun(refIm, testIm, com, show);
                 }
                 catch (exception& e)
@@ -256,19 +288,45 @@ void process(string name, vector<unittest> tests, bool record, bool show, bool m
 int main( int argc, char** argv )
 {
     map<string,vector<unittest>> p;
-    p["inverse"] = {unittest("./inverse -I cat.jpg -O out.png")};
-    p["normalize"] = {unittest("./normalize -I blobs-bad.png -O out.png")};
-    p["ccAreaFilter"] = {unittest("./ccAreaFilter -I binary.png -F 200 -O out.png")};
-    p["ccLabel"] = {unittest("./ccLabel -I binary.png -O out.png", compImBijection)};
-    p["ccLabel2pass"] = {unittest("./ccLabel2pass -I binary.png -O out.png", compImBijection)};
-    p["equalize"] = {unittest("./equalize -I camera_mauvaise_balance.png -O out.png")};
+    p["inverse"] = {unittest("./inverse -I cat.jpg -O out.png"),
+                    unittest("./inverse -I cat.jpg -B -O out.png", compImExact)};
+    // blobs-bad.pgm holds the pixels of blobs-bad.png, so normalize2.png is intentionally a copy of normalize1.png
+    p["normalize"] = {unittest("./normalize -I blobs-bad.png -O out.png"),
+                    unittest("./normalize -I blobs-bad.pgm -R 64 -O out.pgm", compIm, "out.pgm")};
+    p["ccAreaFilter"] = {unittest("./ccAreaFilter -I binary.png -F 200 -O out.png"),
+                        unittest("./ccAreaFilter -I binary.png -F 200 -R -O out.png"),
+                        unittest("./ccAreaFilter -I blood.png -F 20 -O out.png"),
+                        unittest("./ccAreaFilter -I blood.png -F 20 -C 4 -O out.png")};
+    p["ccLabel"] = {unittest("./ccLabel -I binary.png -O out.png", compImBijection),
+                    unittest("./ccLabel -I binary.png -R -O out.png", compImBijection),
+                    unittest("./ccLabel -I binary.png -C 8 -O out.png", compImBijection),
+                    unittest("./ccLabel -I binary.png -L -O out.png")};
+    p["ccLabel2pass"] = {unittest("./ccLabel2pass -I binary.png -O out.png", compImBijection),
+                        unittest("./ccLabel2pass -I binary.png -P -O out.png", compImBijection),
+                        unittest("./ccLabel2pass -I binary.png -P -C 8 -O out.png", compImBijection),
+                        unittest("./ccLabel2pass -I binary.png -L -O out.png")};
+    p["ccStream"] = {unittest("./ccStream -I binary.png -O components.csv -L out.png", compImBijection),
+                    unittest("./ccStream -I binary.png -C 8 -O components.csv -L out.png", compImBijection)};
+    p["maxTreeFilter"] = {unittest("./maxTreeFilter -I camera.png -A area -F 500 -O out.png"),
+                          unittest("./maxTreeFilter -I camera.png -A volume -F 20000 -C 8 -O out.png")};
+    p["equalize"] = {unittest("./equalize -I camera_mauvaise_balance.png -O out.png"),
+                    unittest("./equalize -I img1-11.tiff -D 8 -O out.png")};
+    p["equalizeAdaptive"] = {unittest("./equalizeAdaptive -I camera_mauvaise_balance.png -O out.png")};
+    p["equalizeSequence"] = {unittest("./equalizeSequence -I camera.png camera_mauvaise_balance.png camera_mauvaise_balance.png -O out.png out.png out.png"),
+                            unittest("./equalizeSequence -I camera.png camera_mauvaise_balance.png -W 1 -T 0 -O out2.png out.png", compImExact)};
     p["expand"] = {unittest("./expand -I cat.jpg -F 3 -P nearest -O out.png"), 
-                    unittest("./expand -I cat.jpg -F 3 -P bilinear -O out.png")};
-    p["quantize"] = {unittest("./quantize -I cat.jpg -Q 3 -O out.png")};
+                    unittest("./expand -I cat.jpg -F 3 -P bilinear -O out.png"),
+                    unittest("./expand -I cat.jpg -F 3 -P bicubic -O out.png")};
+    p["quantize"] = {unittest("./quantize -I cat.jpg -Q 3 -O out.png"),
+                    unittest("./quantize -I cat.jpg -Q 3 -B -O out.png", compImExact)};
     p["rotate"] = {unittest("./rotate -I cat.jpg -A 30 -P nearest -O out.png"), 
-                    unittest("./rotate -I cat.jpg -A 30 -P bilinear -O out.png")};
-    p["threshold"] = {unittest("./threshold -I cat.jpg -L 0.2 -H 0.8 -O out.png")};
-    p["transpose"] = {unittest("./transpose -I cat.jpg -O out.png")};
+                    unittest("./rotate -I cat.jpg -A 30 -P bilinear -O out.png"),
+                    unittest("./rotate -I cat.jpg -A 30 -P bicubic -O out.png"),
+                    unittest("./rotate -I cat.jpg -A 90 -P bilinear -O out.png")};
+    p["threshold"] = {unittest("./threshold -I cat.jpg -L 0.2 -H 0.8 -O out.png"),
+                    unittest("./threshold -I cat.jpg -L 0.2 -H 0.8 -B -O out.png", compImExact)};
+    p["transpose"] = {unittest("./transpose -I cat.jpg -O out.png"),
+                      unittest("./transpose -I cat.jpg -K -O out.png")};
 
     p["convolution"] = {unittest("./convolution -I cat.jpg -O out.png -K maskGauss5x5.png")};
     p["meanFilter"] = {unittest("./meanFilter -I cat.jpg -M 5 -O out.png")};
@@ -277,9 +335,11 @@ int main( int argc, char** argv )
 
     p["median"] = {unittest("./median -I camera_bruit_poivre_et_sel.png -M 2 -O out.png")};
     p["erode"] = {unittest("./erode -I binary.png -E morphoLineV.png -O out.png"),
-                    unittest("./erode -I cat.jpg -E morphoCross.png -O out.png")};
+                    unittest("./erode -I cat.jpg -E morphoCross.png -O out.png"),
+                    unittest("./erode -I binary.png -E morphoLineV.png -R -O out.png", compImExact)};
     p["dilate"] = {unittest("./dilate -I binary.png -E morphoLineV.png -O out.png"),
-                    unittest("./dilate -I cat.jpg -E morphoLineV.png -O out.png")};
+                    unittest("./dilate -I cat.jpg -E morphoLineV.png -O out.png"),
+                    unittest("./dilate -I binary.png -E morphoLineV.png -R -O out.png", compImExact)};
     p["open"] = {unittest("./open -I binary.png -E morphoLineV.png -O out.png"),
                 unittest("./open -I cat.jpg -E morphoLineV.png -O out.png")};
     p["close"] = {unittest("./close -I binary.png -E morphoCircle.png -O out.png"),
@@ -287,18 +347,26 @@ int main( int argc, char** argv )
     p["morphologicalGradient"]  = {unittest("./morphologicalGradient -I binary.png -E morphoCross.png -O out.png"),
                                 unittest("./morphologicalGradient -I cat.jpg -E morphoCross.png -O out.png")};
 
-    p["thresholdOtsu"] = {unittest("./thresholdOtsu -I cat.jpg -O out.png")};
+    p["matchHistogram"] = {unittest("./matchHistogram -I camera_mauvaise_balance.png -R lenna.png -O out.png")};
+
+    p["pointPipeline"] = {unittest("./pointPipeline -I camera.png -P normalize:0:1:0.1:0.9,gamma:0.5,quantize:6,threshold:0.3:0.9 -O out.png"),
+                        unittest("./pointPipeline -I camera.png -P normalize:0:1:0.1:0.9,gamma:0.5,quantize:6,threshold:0.3:0.9 -B -O out.png", compImExact),
+                        unittest("./pointPipeline -I camera.png -P normalize:0:1:0.1:0.9,gamma:0.5,quantize:6,threshold:0.3:0.9 -B -N -O out.png", compImExact),
+                        unittest("./pointPipeline -I camera.png -P normalize:0:1:0.1:0.9,gamma:0.5,quantize:6,threshold:0.3:0.9 -N -O out.png")};
+
+    p["thresholdOtsu"] = {unittest("./thresholdOtsu -I cat.jpg -O out.png"),
+                        unittest("./thresholdOtsu -I camera.png -K 4 -O out.png")};
 
     /*p["detectRectangle"] = {"./detectRectangle -I cas1.png -O out.png",
                             "./detectRectangle -I cas2.png -O out.png",
                             "./detectRectangle -I cas3.png -O out.png",
                             "./detectRectangle -I cas4.png -O out.png",
                             "./detectRectangle -I cas5.png -O out.png",
-                            "./detectRectangle -I cas6.png -O out.png"};
+                            "./detectRectangle -I cas6.png -O out.png"};*/
     
-    p["thresholdKMean"] = {"./thresholdKMean -I cat.jpg -O out.png"};
+    p["thresholdKMean"] = {unittest("./thresholdKMean -I cat.jpg -O out.png")};
     
-    p["thresholdSigmaClipping"] = {"./thresholdSigmaClipping -I img1-11.tiff -O out.png"};*/
+    p["thresholdSigmaClipping"] = {unittest("./thresholdSigmaClipping -I img1-11.tiff -O out.png")};
 
     CLI::App app{"Test program"};
 
@@ -25,10 +25,13 @@ int main( int argc, char** argv )
     float thresholdHigh = 0;
     app.add_option("-H,--thresholdHigh", thresholdHigh, "High threshold")->required();
 
+    bool eightBits = false;
+    app.add_flag("-B,--eightBits", eightBits, "Process the unsigned char image (through a lookup table) instead of the float image");
+
     CLI11_PARSE(app, argc, argv);
 
 
-    Mat image = imreadHelper(inputImage);
+    Mat image = imreadHelper(inputImage, !eightBits);
     Mat res_image = threshold(image, thresholdLow, thresholdHigh);
     imwriteHelper(res_image, outputImage);
 
@@ -19,10 +19,22 @@ int main( int argc, char** argv )
     bool showImages = false;
     app.add_flag("-S,--show", showImages, "Display input and output images in new windows");
 
+    int numberOfClasses = 2;
+    app.add_option("-K,--classes", numberOfClasses, "Number of classes (multi-level Otsu when greater than 2)");
+
     CLI11_PARSE(app, argc, argv);
 
+    if (numberOfClasses < 2) {
+        std::cerr << "The number of classes must be at least 2" << std::endl;
+        exit(1);
+    }
+
     Mat image = imreadHelper(inputImage, false);
-    Mat res_image = thresholdOtsu(image);
+    Mat res_image;
+    if (numberOfClasses == 2)
+        res_image = thresholdOtsu(image);
+    else
+        res_image = thresholdOtsuMulti(image, numberOfClasses);
     imwriteHelper(res_image, outputImage);
 
     // maybe show result
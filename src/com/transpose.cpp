@@ -19,9 +19,12 @@ int main( int argc, char** argv )
     bool showImages = false;
     app.add_flag("-S,--show", showImages, "Display input and output images in new windows");
 
+    bool keepType = false;
+    app.add_flag("-K,--keepType", keepType, "Keep the type and the channels of the input image instead of converting it to grayscale float");
+
     CLI11_PARSE(app, argc, argv);
 
-    Mat image = imreadHelper(inputImage);
+    Mat image = keepType ? imreadHelper(inputImage, false, false) : imreadHelper(inputImage);
     Mat res_image = transpose(image);
     imwriteHelper(res_image, outputImage);
 
@@ -0,0 +1,75 @@
+#include "../common.h"
+#include "../tpGeometry.h"
+#include <cstring>
+#include "CLI11.hpp"
+
+using namespace cv;
+using namespace std;
+
+/**
+    Reference transposition: one element copied at a time in raster order of the source.
+*/
+static Mat naiveTranspose(const Mat& image)
+{
+    Mat res(image.cols, image.rows, image.type());
+    size_t elementSize = image.elemSize();
+    for (int i = 0; i < image.rows; i++) {
+        for (int j = 0; j < image.cols; j++)
+            memcpy(res.ptr(j) + i * elementSize, image.ptr(i) + j * elementSize, elementSize);
+    }
+    return res;
+}
+
+/**
+    Mean time in milliseconds of repetitions calls to f().
+*/
+template<typename Function>
+static double timeFunction(Function f, int repetitions)
+{
+    int64 start = getTickCount();
+    for (int r = 0; r < repetitions; r++) {
+        f();
+    }
+    return (getTickCount() - start) * 1000.0 / getTickFrequency() / repetitions;
+}
+
+int main( int argc, char** argv )
+{
+    CLI::App app{"Transpose benchmark"};
+
+    string inputImage = "cat.jpg";
+    app.add_option("-I,--inputImage", inputImage, "Input image filename");
+
+    int tiles = 8;
+    app.add_option("-T,--tiles", tiles, "The input image is repeated tiles x tiles times");
+
+    int repetitions = 5;
+    app.add_option("-R,--repetitions", repetitions, "Number of runs of each measure");
+
+    CLI11_PARSE(app, argc, argv);
+
+    Mat color = imreadHelper(inputImage, false, false);
+    if (color.channels() == 1)
+        cvtColor(color, color, COLOR_GRAY2BGR);
+    color = repeat(color, tiles, tiles);
+    Mat gray, colorAlpha, grayFloat;
+    cvtColor(color, gray, COLOR_BGR2GRAY);
+    cvtColor(color, colorAlpha, COLOR_BGR2BGRA);
+    gray.convertTo(grayFloat, CV_32F, 1.0 / 255);
+    cout << "Image size: " << color.cols << "x" << color.rows << endl;
+
+    const char* names[] = {"8UC1", "8UC3", "8UC4", "32FC1"};
+    Mat images[] = {gray, color, colorAlpha, grayFloat};
+    cout << "type\tnaive (ms)\ttranspose (ms)\tspeedup\tin place, square (ms)" << endl;
+    for (int k = 0; k < 4; k++) {
+        Mat image = images[k];
+        int side = std::min(image.rows, image.cols);
+        Mat square = image(Rect(0, 0, side, side)).clone();
+        double naive = timeFunction([&]() { naiveTranspose(image); }, repetitions);
+        double tiled = timeFunction([&]() { transpose(image); }, repetitions);
+        double inPlace = timeFunction([&]() { transposeInPlace(square); }, repetitions);
+        cout << names[k] << "\t" << naive << "\t" << tiled << "\t" << naive / tiled << "\t" << inPlace << endl;
+    }
+
+    return 0;
+}
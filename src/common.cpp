@@ -1,16 +1,34 @@
 #include "common.h"
 #include <exception>
 #include <iostream>
-#include <map>
+#include <algorithm>
+#include <cctype>
+#include <climits>
+#include <vector>
 #include "stdio.h"
 
 using namespace cv;
 using namespace std;
 
-cv::Mat imreadHelper(std::string filename, bool forceFloat, bool forceGrayScale)
+static int verbosityLevel = 0;
+
+void setVerbosity(int level)
+{
+    verbosityLevel = level;
+}
+
+int getVerbosity()
+{
+    return verbosityLevel;
+}
+
+cv::Mat imreadHelper(std::string filename, bool forceFloat, bool forceGrayScale, bool keepDepth)
 {
     cv::Mat image;
-    image = cv::imread( filename.c_str(), (forceGrayScale)? 0 : -1 );
+    int flags = (forceGrayScale)? 0 : -1;
+    if(keepDepth && forceGrayScale)
+        flags |= cv::IMREAD_ANYDEPTH;
+    image = cv::imread( filename.c_str(), flags );
 
     if( !image.data )
     {
@@ -47,7 +65,7 @@ cv::Mat imreadHelper(std::string filename, bool forceFloat, bool forceGrayScale)
 void imwriteHelper(cv::Mat image, std::string filename)
 {
     int depth = image.depth();
-    if(depth<=1)
+    if(depth<=1 || depth == CV_16U)
     {
         cv::imwrite(filename.c_str(), image);
     } else {
@@ -64,6 +82,130 @@ void imwriteHelper(cv::Mat image, std::string filename)
 
 }
 
+void imwriteLabels(cv::Mat labels, std::string filename)
+{
+    CV_Assert(labels.type() == CV_32SC1);
+    string extension = filename.substr(filename.find_last_of('.') + 1);
+    std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+    if (extension == "tif" || extension == "tiff") {
+        cv::imwrite(filename.c_str(), labels);
+        return;
+    }
+    if (extension != "png")
+        throw std::runtime_error("Labels can only be written as PNG or TIFF images");
+
+    double min, max;
+    cv::minMaxLoc(labels, &min, &max);
+    if (min < 0 || max > 65535)
+        throw std::runtime_error("Labels out of [0, 65535] cannot be written as PNG, use a TIFF image");
+    cv::Mat tmp;
+    labels.convertTo(tmp, CV_16U);
+    cv::imwrite(filename.c_str(), tmp);
+}
+
+/**
+    Reads the next header field of a PGM file, skipping white spaces and comments.
+*/
+static int readPgmField(std::ifstream& file)
+{
+    int c = file.get();
+    while(c != EOF && (isspace(c) || c == '#'))
+    {
+        if(c == '#')
+            while(c != EOF && c != '\n')
+                c = file.get();
+        c = file.get();
+    }
+    file.unget();
+    int value = -1;
+    if(!(file >> value))
+        throw std::runtime_error("Invalid PGM header");
+    return value;
+}
+
+PgmStripReader::PgmStripReader(std::string filename): file(filename.c_str(), std::ios::in | std::ios::binary), nextRow(0)
+{
+    if(!file)
+        throw std::runtime_error("No Image Data");
+    char magic[2] = {0, 0};
+    file.read(magic, 2);
+    if(magic[0] != 'P' || magic[1] != '5')
+        throw std::runtime_error("Only binary PGM (P5) images can be read by strips");
+    width = readPgmField(file);
+    height = readPgmField(file);
+    maxValue = readPgmField(file);
+    if(width <= 0 || height <= 0 || maxValue <= 0 || maxValue > 65535)
+        throw std::runtime_error("Invalid PGM header");
+    // a single white space separates the header from the pixels
+    file.get();
+    dataStart = file.tellg();
+}
+
+bool PgmStripReader::read(cv::Mat& strip, int maxRows)
+{
+    if(nextRow >= height)
+        return false;
+    int n = std::min(maxRows, height - nextRow);
+    strip.create(n, width, depth());
+    for(int i = 0; i < n; i++)
+        file.read((char *)strip.ptr(i), width * strip.elemSize());
+    if(!file)
+        throw std::runtime_error("Truncated PGM image");
+    // PGM stores 16 bits values most significant byte first
+    if(depth() == CV_16U)
+    {
+        for(int i = 0; i < n; i++)
+        {
+            uchar * row = strip.ptr(i);
+            for(int j = 0; j < width; j++)
+                std::swap(row[2 * j], row[2 * j + 1]);
+        }
+    }
+    nextRow += n;
+    return true;
+}
+
+void PgmStripReader::rewind()
+{
+    file.clear();
+    file.seekg(dataStart);
+    nextRow = 0;
+}
+
+PgmStripWriter::PgmStripWriter(std::string filename, int rows, int cols, int _depth): file(filename.c_str(), std::ios::out | std::ios::binary), width(cols), depth(_depth)
+{
+    if(!file)
+        throw std::runtime_error("Cannot write " + filename);
+    if(depth != CV_8U && depth != CV_16U)
+        throw std::runtime_error("Only 8 and 16 bits PGM images can be written");
+    file << "P5\n" << cols << " " << rows << "\n" << ((depth == CV_8U) ? 255 : 65535) << "\n";
+}
+
+void PgmStripWriter::write(const cv::Mat& strip)
+{
+    CV_Assert(strip.cols == width && strip.depth() == depth && strip.channels() == 1);
+    std::vector<uchar> row(width * strip.elemSize());
+    for(int i = 0; i < strip.rows; i++)
+    {
+        const uchar * src = strip.ptr(i);
+        if(depth == CV_16U)
+        {
+            for(int j = 0; j < width; j++)
+            {
+                row[2 * j] = src[2 * j + 1];
+                row[2 * j + 1] = src[2 * j];
+            }
+        }
+        else
+        {
+            std::copy(src, src + width, row.begin());
+        }
+        file.write((const char *)&row[0], row.size());
+    }
+    if(!file)
+        throw std::runtime_error("Error while writing PGM image");
+}
+
 void showimage(cv::Mat image, const char * name)
 {
     static int count = 1;
@@ -83,24 +225,85 @@ void showimage(cv::Mat image, const char * name)
 }
 
 
-cv::Mat remap_labels(cv::Mat label_image)
+/**
+    Remaps the keys (in [0, numberOfKeys)) of an image with a flat lookup table: the keys are
+    numbered from 1 in the raster order of their first occurrence, except zeroKey (if >= 0) which
+    becomes 0. The first occurrences are found by a sequential pre-pass, the table is then applied
+    to the rows in parallel.
+*/
+template<typename KeyOf>
+static Mat remapKeys(const Mat& image, int numberOfKeys, int zeroKey, KeyOf keyOf)
 {
-    map<int, int> label_map;
-    label_map[0] = 0;
-
-    Mat res = Mat::zeros(label_image.rows, label_image.cols, CV_32SC1);
-    int current_label = 1;
-
-    for(int y = 0; y < label_image.rows; ++y){
-        for(int x = 0; x < label_image.cols; ++x){
-            int l = label_image.at<int>(y, x);
-            if(label_map.count(l) == 0){
-                label_map[l] = current_label;
-                current_label++;
-            }
-            res.at<int>(y, x) = label_map[l];
+    vector<int> lut(numberOfKeys, -1);
+    if (zeroKey >= 0)
+        lut[zeroKey] = 0;
+    int nextLabel = 1;
+    for (int y = 0; y < image.rows; ++y) {
+        const int* row = image.ptr<int>(y);
+        for (int x = 0; x < image.cols; ++x) {
+            int& label = lut[keyOf(row[x])];
+            if (label < 0)
+                label = nextLabel++;
         }
     }
 
+    Mat res(image.rows, image.cols, CV_32SC1);
+    parallel_for_(Range(0, image.rows), [&](const Range& range) {
+        for (int y = range.start; y < range.end; ++y) {
+            const int* row = image.ptr<int>(y);
+            int* dst = res.ptr<int>(y);
+            for (int x = 0; x < image.cols; ++x)
+                dst[x] = lut[keyOf(row[x])];
+        }
+    });
     return res;
-}
\ No newline at end of file
+}
+
+/**
+    The values of the label image (CV_32S, or any 32 bits image whose values are read as int) are
+    used as indices of a flat table when their range is at most about twice the number of pixels.
+    Otherwise the distinct values are first sorted and replaced by their rank.
+*/
+cv::Mat remap_labels(cv::Mat label_image)
+{
+    CV_Assert(label_image.channels() == 1 && label_image.elemSize() == sizeof(int));
+    if (label_image.empty())
+        return Mat::zeros(label_image.rows, label_image.cols, CV_32SC1);
+
+    int minLabel = INT_MAX, maxLabel = INT_MIN;
+    for (int y = 0; y < label_image.rows; ++y) {
+        const int* row = label_image.ptr<int>(y);
+        for (int x = 0; x < label_image.cols; ++x) {
+            minLabel = std::min(minLabel, row[x]);
+            maxLabel = std::max(maxLabel, row[x]);
+        }
+    }
+
+    int64 range = (int64)maxLabel - minLabel + 1;
+    if (range <= 2 * (int64)label_image.total() + 256) {
+        int zeroKey = (minLabel <= 0 && maxLabel >= 0) ? -minLabel : -1;
+        return remapKeys(label_image, (int)range, zeroKey, [minLabel](int l) { return l - minLabel; });
+    }
+
+    vector<int> values;
+    values.reserve(label_image.total());
+    for (int y = 0; y < label_image.rows; ++y) {
+        const int* row = label_image.ptr<int>(y);
+        values.insert(values.end(), row, row + label_image.cols);
+    }
+    std::sort(values.begin(), values.end());
+    values.erase(std::unique(values.begin(), values.end()), values.end());
+
+    Mat keys(label_image.rows, label_image.cols, CV_32SC1);
+    parallel_for_(Range(0, label_image.rows), [&](const Range& range) {
+        for (int y = range.start; y < range.end; ++y) {
+            const int* row = label_image.ptr<int>(y);
+            int* key = keys.ptr<int>(y);
+            for (int x = 0; x < label_image.cols; ++x)
+                key[x] = (int)(std::lower_bound(values.begin(), values.end(), row[x]) - values.begin());
+        }
+    });
+    vector<int>::const_iterator zero = std::lower_bound(values.begin(), values.end(), 0);
+    int zeroKey = (zero != values.end() && *zero == 0) ? (int)(zero - values.begin()) : -1;
+    return remapKeys(keys, (int)values.size(), zeroKey, [](int k) { return k; });
+}
@@ -3,6 +3,7 @@
 #pragma once
 #include <opencv2/opencv.hpp>
 #include <string>
+#include <fstream>
 #include <initializer_list>
 
 
@@ -13,20 +14,88 @@
         - forceFloat: ensures that the loaded image is in float format. If original image
             was a byte image, its values are divided by 255.
         - forceGrayScale: ensures that the loaded image contains a single channel
+        - keepDepth: loads 16 bits and 32 bits images without converting them to 8 bits
+            (only meaningful when forceFloat is false)
 */
-cv::Mat imreadHelper(std::string filename, bool forceFloat=true, bool forceGrayScale=true);
+cv::Mat imreadHelper(std::string filename, bool forceFloat=true, bool forceGrayScale=true, bool keepDepth=false);
 
 /**
     Write an image to disk.
+    8 bits and 16 bits images are written as is, float images are supposed to be in [0,1].
 */
 void imwriteHelper(cv::Mat image, std::string filename);
 
+/**
+    Write a label image (CV_32S) without loss: as a 16 bits PNG (labels in [0, 65535])
+    or as a 32 bits TIFF, depending on the extension of filename.
+*/
+void imwriteLabels(cv::Mat labels, std::string filename);
+
+/**
+    Reads a binary PGM (P5) image, 8 or 16 bits per pixel, by horizontal strips
+    so that images larger than the memory can be processed.
+*/
+class PgmStripReader
+{
+public:
+    explicit PgmStripReader(std::string filename);
+
+    int rows() const { return height; }
+    int cols() const { return width; }
+    int depth() const { return (maxValue > 255) ? CV_16U : CV_8U; }
+    int maxVal() const { return maxValue; }
+
+    /**
+        Reads the next (at most maxRows) rows of the image into strip.
+        Returns false when all the rows have already been read.
+    */
+    bool read(cv::Mat& strip, int maxRows);
+
+    /**
+        Goes back to the first row of the image.
+    */
+    void rewind();
+
+private:
+    std::ifstream file;
+    std::streampos dataStart;
+    int width, height, maxValue;
+    int nextRow;
+};
+
+/**
+    Writes a binary PGM (P5) image, 8 or 16 bits per pixel, by horizontal strips.
+*/
+class PgmStripWriter
+{
+public:
+    PgmStripWriter(std::string filename, int rows, int cols, int depth);
+
+    /**
+        Appends the rows of strip (of the writer depth) to the image.
+    */
+    void write(const cv::Mat& strip);
+
+private:
+    std::ofstream file;
+    int width, depth;
+};
+
+/**
+    Verbosity level of the diagnostics printed by the library functions:
+    0 (default) prints nothing, higher levels print more details.
+*/
+void setVerbosity(int level);
+
+int getVerbosity();
+
 /**
     Display an image in a window with the given name as title.
 */
 void showimage(cv::Mat image, const char * name=NULL);
 
 /**
- * Remaps a label image between 0 and the number of labels - 1
+ * Remaps a label image between 0 and the number of labels - 1:
+ * 0 stays 0 and the other labels are numbered from 1 in the raster order of their first pixel.
  */
 cv::Mat remap_labels(cv::Mat label_image);
\ No newline at end of file
@@ -1,234 +1,1252 @@
 #include "tpConnectedComponents.h"
+#include "common.h"
 #include <cmath>
 #include <algorithm>
 #include <tuple>
 #include <vector>
 #include <map>
-#include <stack>
+#include <iostream>
+#include <climits>
 using namespace cv;
 using namespace std;
 
 
 /**
-    Performs a labeling of image connected component with 4 connectivity
-    with a depth-first exploration.
-    Any non zero pixel of the image is considered as present.
+    Disjoint sets of labels stored in a preallocated contiguous array,
+    with path compression (halving) and union by rank.
 */
-cv::Mat ccLabel(cv::Mat image)
+class UnionFind
+{
+public:
+    explicit UnionFind(int capacity): parent(capacity), rank(capacity, 0), numberOfSets(0)
+    {
+    }
+
+    /**
+        Creates a new singleton set and returns its element.
+    */
+    int makeSet()
+    {
+        parent[numberOfSets] = numberOfSets;
+        rank[numberOfSets] = 0;
+        return numberOfSets++;
+    }
+
+    int find(int x)
+    {
+        while (parent[x] != x) {
+            parent[x] = parent[parent[x]];
+            x = parent[x];
+        }
+        return x;
+    }
+
+    /**
+        Merges the sets of a and b and returns the root of the union.
+    */
+    int merge(int a, int b)
+    {
+        a = find(a);
+        b = find(b);
+        if (a == b)
+            return a;
+        if (rank[a] < rank[b])
+            std::swap(a, b);
+        parent[b] = a;
+        if (rank[a] == rank[b])
+            rank[a]++;
+        return a;
+    }
+
+    /**
+        Creates the singleton sets [size(), n).
+    */
+    void makeSets(int n)
+    {
+        while (numberOfSets < n)
+            makeSet();
+    }
+
+    int size() const { return numberOfSets; }
+
+private:
+    vector<int> parent;
+    vector<uchar> rank;
+    int numberOfSets;
+};
+
+/**
+    Binary version (0 or 255) of an unsigned char image or a float image in [0,1].
+*/
+static Mat toBinary(Mat image)
 {
-    std::cout << "Starting ccLabel..." << std::endl;
     Mat binary;
     if(image.depth() == CV_32F) {
-        std::cout << "Converting float image to binary..." << std::endl;
         image = image * 255;
         image.convertTo(binary, CV_8UC1);
     } else {
-        std::cout << "Copying image to binary..." << std::endl;
         image.copyTo(binary);
     }
-    std::cout << "Thresholding image..." << std::endl;
     threshold(binary, binary, 127, 255, THRESH_BINARY);
-    
-    std::cout << "Creating result matrix..." << std::endl;
+    return binary;
+}
+
+/**
+    Labels with label the connected component (4 or 8 connectivity) of the binary image containing
+    the pixel (row, col) with a scanline flood fill: the whole run of unlabeled present pixels
+    containing a pixel is labeled at once, and the intervals of the rows above and below the run
+    (widened by one pixel on each side with 8 connectivity) are pushed on the stack to be scanned
+    for new runs. Each run is labeled once and pushes 2 intervals, so the size of the stack is
+    bounded by twice the number of runs of the component.
+*/
+static void fillComponent(const Mat& binary, Mat& labels, int row, int col, int label, int connectivity)
+{
+    int reach = (connectivity == 8) ? 1 : 0;
+    struct Interval { int row, left, right; };
+    vector<Interval> stack;
+    Interval seed = {row, col, col};
+    stack.push_back(seed);
+
+    int cols = binary.cols;
+    while (!stack.empty()) {
+        Interval interval = stack.back();
+        stack.pop_back();
+        const uchar* present = binary.ptr<uchar>(interval.row);
+        int* rowLabels = labels.ptr<int>(interval.row);
+
+        for (int j = interval.left; j <= interval.right; j++) {
+            if (present[j] == 0 || rowLabels[j] != 0)
+                continue;
+            int left = j, right = j;
+            while (left > 0 && present[left - 1] != 0 && rowLabels[left - 1] == 0)
+                left--;
+            while (right + 1 < cols && present[right + 1] != 0 && rowLabels[right + 1] == 0)
+                right++;
+            std::fill(rowLabels + left, rowLabels + right + 1, label);
+
+            int scanLeft = std::max(left - reach, 0), scanRight = std::min(right + reach, cols - 1);
+            if (interval.row > 0) {
+                Interval above = {interval.row - 1, scanLeft, scanRight};
+                stack.push_back(above);
+            }
+            if (interval.row + 1 < binary.rows) {
+                Interval below = {interval.row + 1, scanLeft, scanRight};
+                stack.push_back(below);
+            }
+            j = right;
+        }
+    }
+}
+
+/**
+    Performs a labeling of image connected component with 4 or 8 connectivity
+    with a scanline flood fill.
+    Any non zero pixel of the image is considered as present.
+    Returns the label image (CV_32S, 0 for the background), the components being numbered
+    from 1 to numberOfComponents in the raster order of their first pixel.
+
+    Diagnostics are printed with a verbosity level of at least 1 (progress)
+    or 2 (one line per component), see setVerbosity.
+*/
+cv::Mat ccLabelRaw(cv::Mat image, int& numberOfComponents, int connectivity)
+{
+    CV_Assert(connectivity == 4 || connectivity == 8);
+    int verbosity = getVerbosity();
+    if (verbosity >= 1)
+        std::cout << "Starting ccLabel..." << std::endl;
+
+    Mat binary = toBinary(image);
     Mat res = Mat::zeros(image.rows, image.cols, CV_32SC1);
     int currentLabel = 1;
-    
-    std::cout << "Starting image scan..." << std::endl;
-    try {
-        for(int i = 0; i < binary.rows; i++) {
-            for(int j = 0; j < binary.cols; j++) {
-                if(binary.at<uchar>(i, j) != 0 && res.at<int>(i, j) == 0) {
-                    std::cout << "Found new component at (" << i << "," << j << ") with label " << currentLabel << std::endl;
-                    
-                    std::stack<std::pair<int, int>> stack;
-                    stack.push(std::make_pair(i, j));
-                    
-                    while(!stack.empty()) {
-                        int row = stack.top().first;
-                        int col = stack.top().second;
-                        stack.pop();
-                        
-                        if (row < 0 || row >= binary.rows || col < 0 || col >= binary.cols) 
-                            continue;
-                        if (binary.at<uchar>(row, col) == 0 || res.at<int>(row, col) != 0) 
-                            continue;
-                        
-
-                        res.at<int>(row, col) = currentLabel;
-                        
-
-                        stack.push(std::make_pair(row-1, col)); 
-                        stack.push(std::make_pair(row+1, col)); 
-                        stack.push(std::make_pair(row, col-1)); 
-                        stack.push(std::make_pair(row, col+1)); 
-                    }
-                    
-                    currentLabel++;
-                }
+
+    for (int i = 0; i < binary.rows; i++) {
+        const uchar* present = binary.ptr<uchar>(i);
+        const int* labels = res.ptr<int>(i);
+        for (int j = 0; j < binary.cols; j++) {
+            if (present[j] != 0 && labels[j] == 0) {
+                if (verbosity >= 2)
+                    std::cout << "Found new component at (" << i << "," << j << ") with label " << currentLabel << "\n";
+                fillComponent(binary, res, i, j, currentLabel, connectivity);
+                currentLabel++;
             }
         }
-    } catch (const std::exception& e) {
-        std::cerr << "Error during image scan: " << e.what() << std::endl;
-        throw;
     }
-    
-    std::cout << "Converting to float..." << std::endl;
+
+    numberOfComponents = currentLabel - 1;
+    if (verbosity >= 1)
+        std::cout << "ccLabel completed: " << numberOfComponents << " components." << std::endl;
+    return res;
+}
+
+/**
+    Labels of ccLabelRaw normalized to [0,1] (CV_32F).
+*/
+cv::Mat ccLabel(cv::Mat image, int connectivity)
+{
+    int numberOfComponents;
     Mat normalized;
-    res.convertTo(normalized, CV_32FC1);
+    ccLabelRaw(image, numberOfComponents, connectivity).convertTo(normalized, CV_32FC1);
     normalize(normalized, normalized, 0, 1, NORM_MINMAX);
-    
-    std::cout << "ccLabel completed." << std::endl;
     return normalized;
 }
 
 /**
-    Deletes the connected components (4 connectivity) containg less than size pixels.
+    Deletes the connected components (4 or 8 connectivity) containg less than size pixels.
+    The default 8 connectivity is the one of the original implementation based on cv::connectedComponents.
+
+    The function has no side effect: nothing is written or displayed, except the number of
+    components with a verbosity level of at least 1 and their sizes with a level of at least 2
+    (see setVerbosity).
 */
-Mat ccAreaFilter(Mat image, int size)
+Mat ccAreaFilter(Mat image, int size, int connectivity)
 {
     if (image.empty()) {
         cerr << "Erreur : Impossible de charger l'image d'entrée !" << endl;
         return Mat();
     }
 
-    Mat binary;
-    if (image.depth() == CV_32F) {
-        image = image * 255; 
-        image.convertTo(binary, CV_8UC1);
-    } else {
-        image.copyTo(binary);
+    int verbosity = getVerbosity();
+    ComponentStats stats;
+    Mat labels = ccStats(image, stats, connectivity);
+
+    if (verbosity >= 1)
+        cout << "Nombre total de labels détectés : " << stats.count << "\n";
+    if (verbosity >= 2) {
+        for (int l = 1; l <= stats.count; l++) {
+            cout << "Label " << l << " -> Taille : " << stats.area[l] << " pixels\n";
+        }
     }
-    threshold(binary, binary, 127, 255, THRESH_BINARY);
 
-    Mat labels;
-    int numLabels = connectedComponents(binary, labels, 8, CV_32S);
-    cout << "Nombre total de labels détectés : " << numLabels - 1 << endl;
+    vector<uchar> selected(stats.count + 1);
+    int numberOfSelected = 0;
+    for (int l = 1; l <= stats.count; l++) {
+        selected[l] = stats.area[l] >= size;
+        numberOfSelected += selected[l];
+    }
 
-    map<int, int> labelCount;
-    for (int i = 0; i < labels.rows; i++) {
-        for (int j = 0; j < labels.cols; j++) {
-            int label = labels.at<int>(i, j);
-            if (label > 0) {
-                labelCount[label]++;
+    if (verbosity >= 1 && numberOfSelected == 0) {
+        cerr << "Attention : L'image finale est vide après filtrage ! Aucun composant ne dépasse le seuil." << endl;
+    }
+
+    return ccSelect(labels, selected);
+}
+
+
+
+/**
+    First pass of the 2 pass labeling with 4 connectivity: gives a provisional label to each
+    pixel of the binary image and records the equivalences between provisional labels.
+
+    The scan follows a decision tree on the neighbours above (q), on the left (s) and
+    above-left (p) of the current pixel: the label of q is copied when q is present, otherwise
+    the label of s, and a new label is created when both are absent. An equivalence is only
+    recorded when q and s are present and p is absent: when p is present, q and s are already
+    connected through it.
+*/
+static void firstPass4(const Mat& binary, Mat& labels, UnionFind& equivalences)
+{
+    int cols = binary.cols;
+    for (int i = 0; i < binary.rows; i++) {
+        const uchar* row = binary.ptr<uchar>(i);
+        int* label = labels.ptr<int>(i);
+        if (i == 0) {
+            for (int j = 0; j < cols; j++) {
+                if (row[j] == 0)
+                    label[j] = 0;
+                else if (j > 0 && row[j - 1] != 0)
+                    label[j] = label[j - 1];
+                else
+                    label[j] = equivalences.makeSet();
+            }
+            continue;
+        }
+
+        const uchar* rowAbove = binary.ptr<uchar>(i - 1);
+        const int* labelAbove = labels.ptr<int>(i - 1);
+        if (cols > 0)
+            label[0] = (row[0] == 0) ? 0 : (rowAbove[0] != 0) ? labelAbove[0] : equivalences.makeSet();
+        for (int j = 1; j < cols; j++) {
+            if (row[j] == 0) {
+                label[j] = 0;
+            } else if (rowAbove[j] != 0) {
+                label[j] = labelAbove[j];
+                if (row[j - 1] != 0 && rowAbove[j - 1] == 0)
+                    equivalences.merge(label[j - 1], labelAbove[j]);
+            } else if (row[j - 1] != 0) {
+                label[j] = label[j - 1];
+            } else {
+                label[j] = equivalences.makeSet();
+            }
+        }
+    }
+}
+
+/**
+    First pass of the 2 pass labeling with 8 connectivity. The image is scanned by blocks of
+    2x2 pixels: the present pixels of a block are always connected, so they share a single
+    provisional label and the decision tree is taken once per block instead of once per pixel.
+
+    The block is connected to the blocks above-left (p), above (q), above-right (r) and on the
+    left (s) through the pixels facing it. The label of the first connected block in the order
+    q, p, r, s is copied, and the equivalences with the other connected blocks are recorded,
+    except when the facing pixels are neighbours and thus already connected.
+*/
+static void firstPass8(const Mat& binary, Mat& labels, UnionFind& equivalences)
+{
+    int rows = binary.rows, cols = binary.cols;
+    for (int i = 0; i < rows; i += 2) {
+        bool hasBelow = i + 1 < rows;
+        const uchar* row = binary.ptr<uchar>(i);
+        const uchar* rowBelow = binary.ptr<uchar>(hasBelow ? i + 1 : i);
+        const uchar* rowAbove = binary.ptr<uchar>(i > 0 ? i - 1 : i);
+        int* label = labels.ptr<int>(i);
+        int* labelBelow = labels.ptr<int>(hasBelow ? i + 1 : i);
+        const int* labelAbove = labels.ptr<int>(i > 0 ? i - 1 : i);
+
+        for (int j = 0; j < cols; j += 2) {
+            bool hasRight = j + 1 < cols;
+            // pixels of the block: a b / c d
+            bool a = row[j] != 0;
+            bool b = hasRight && row[j + 1] != 0;
+            bool c = hasBelow && rowBelow[j] != 0;
+            bool d = hasBelow && hasRight && rowBelow[j + 1] != 0;
+
+            int l = 0;
+            if (a || b || c || d) {
+                // pixels facing the block in the row above and in the column on the left
+                bool p = i > 0 && j > 0 && rowAbove[j - 1] != 0;
+                bool qc = i > 0 && rowAbove[j] != 0;
+                bool qd = i > 0 && hasRight && rowAbove[j + 1] != 0;
+                bool r = i > 0 && j + 2 < cols && rowAbove[j + 2] != 0;
+                bool sb = j > 0 && row[j - 1] != 0;
+                bool sd = j > 0 && hasBelow && rowBelow[j - 1] != 0;
+
+                bool connectedP = a && p;
+                bool connectedQ = (a || b) && (qc || qd);
+                bool connectedR = b && r;
+                bool connectedS = (a || c) && (sb || sd);
+                int labelS = sb ? label[j - 1] : (sd ? labelBelow[j - 1] : 0);
+
+                if (connectedQ) {
+                    l = qc ? labelAbove[j] : labelAbove[j + 1];
+                    if (connectedP && !qc)
+                        equivalences.merge(l, labelAbove[j - 1]);
+                    if (connectedR && !qd)
+                        equivalences.merge(l, labelAbove[j + 2]);
+                    if (connectedS && !(sb && qc))
+                        equivalences.merge(l, labelS);
+                } else if (connectedP) {
+                    l = labelAbove[j - 1];
+                    if (connectedR)
+                        equivalences.merge(l, labelAbove[j + 2]);
+                    if (connectedS && !sb)
+                        equivalences.merge(l, labelS);
+                } else if (connectedR) {
+                    l = labelAbove[j + 2];
+                    if (connectedS)
+                        equivalences.merge(l, labelS);
+                } else if (connectedS) {
+                    l = labelS;
+                } else {
+                    l = equivalences.makeSet();
+                }
+            }
+
+            label[j] = a ? l : 0;
+            if (hasRight)
+                label[j + 1] = b ? l : 0;
+            if (hasBelow) {
+                labelBelow[j] = c ? l : 0;
+                if (hasRight)
+                    labelBelow[j + 1] = d ? l : 0;
+            }
+        }
+    }
+}
+
+/**
+    Upper bound of the number of provisional labels created by the first pass, background included:
+    one label every two pixels with 4 connectivity, one label per 2x2 block with 8 connectivity.
+*/
+static int provisionalCapacity(const Mat& binary, int connectivity)
+{
+    if (connectivity == 8)
+        return ((binary.rows + 1) / 2) * ((binary.cols + 1) / 2) + 1;
+    return (int)((binary.total() + 1) / 2) + 1;
+}
+
+static void firstPass(const Mat& binary, Mat& labels, UnionFind& equivalences, int connectivity)
+{
+    CV_Assert(connectivity == 4 || connectivity == 8);
+    if (connectivity == 8)
+        firstPass8(binary, labels, equivalences);
+    else
+        firstPass4(binary, labels, equivalences);
+}
+
+/**
+    Performs a labeling of image connected component with 4 or 8 connectivity using a
+    2 pass algorithm.
+    Any non zero pixel of the image is considered as present.
+    Labels of ccTwoPassLabelRaw divided by the number of components (CV_32F).
+*/
+cv::Mat ccTwoPassLabel(cv::Mat image, int connectivity)
+{
+    int verbosity = getVerbosity();
+    if (verbosity >= 1)
+        std::cout << "Starting ccTwoPassLabel..." << std::endl;
+
+    int numberOfComponents;
+    Mat labels = ccTwoPassLabelRaw(image, numberOfComponents, connectivity);
+    if (numberOfComponents == 0) {
+        if (verbosity >= 1)
+            std::cerr << "Error: All labels are zero. Check input image and labeling process." << std::endl;
+        return Mat::zeros(labels.size(), CV_32FC1);
+    }
+
+    Mat normalized;
+    labels.convertTo(normalized, CV_32FC1, 1.0 / numberOfComponents);
+
+    if (verbosity >= 1)
+        std::cout << "ccTwoPassLabel completed: " << numberOfComponents << " components." << std::endl;
+    return normalized;
+}
+
+/**
+    Performs a labeling of image connected component with 4 or 8 connectivity using a
+    2 pass algorithm run in parallel on horizontal strips.
+    Any non zero pixel of the image is considered as present.
+
+    Each strip is labeled independently with its own provisional labels and equivalences.
+    The labels of the strips are then given disjoint ranges, the components crossing the
+    boundaries between strips are merged, and the final labels are written in parallel.
+    Components are numbered from 1 in the order of creation of their first provisional label
+    (raster order of the pixels with 4 connectivity, of the 2x2 blocks with 8 connectivity),
+    so that the result does not depend on the number of threads. The labels are returned as is
+    (depth CV_32S) or divided by the number of components (depth CV_32F).
+*/
+static Mat labelStrips(Mat image, int connectivity, int depth, int& numberOfComponents)
+{
+    CV_Assert(connectivity == 4 || connectivity == 8);
+    Mat binary = toBinary(image);
+    Mat labels(binary.size(), CV_32SC1);
+    int rows = binary.rows, cols = binary.cols;
+
+    // with 8 connectivity, the strips start on even rows so that their 2x2 blocks are the ones
+    // of the whole image
+    int rowsPerUnit = (connectivity == 8) ? 2 : 1;
+    int units = (rows + rowsPerUnit - 1) / rowsPerUnit;
+    int numberOfStrips = std::max(1, std::min(getNumThreads(), units));
+    vector<int> stripStart(numberOfStrips + 1);
+    for (int s = 0; s <= numberOfStrips; s++)
+        stripStart[s] = std::min(rows, rowsPerUnit * (units * s / numberOfStrips));
+
+    // local labeling of each strip, localRoot[s][l] is the root of the local label l
+    vector<vector<int> > localRoot(numberOfStrips);
+    parallel_for_(Range(0, numberOfStrips), [&](const Range& range) {
+        for (int s = range.start; s < range.end; s++) {
+            Mat stripBinary = binary.rowRange(stripStart[s], stripStart[s + 1]);
+            Mat stripLabels = labels.rowRange(stripStart[s], stripStart[s + 1]);
+            UnionFind equivalences(provisionalCapacity(stripBinary, connectivity));
+            equivalences.makeSet();
+            firstPass(stripBinary, stripLabels, equivalences, connectivity);
+
+            vector<int>& root = localRoot[s];
+            root.resize(equivalences.size());
+            for (int l = 0; l < equivalences.size(); l++)
+                root[l] = equivalences.find(l);
+        }
+    });
+
+    // the local label l >= 1 of the strip s becomes offset[s] + l - 1
+    vector<int> offset(numberOfStrips + 1, 1);
+    for (int s = 0; s < numberOfStrips; s++)
+        offset[s + 1] = offset[s] + (int)localRoot[s].size() - 1;
+    auto globalLabel = [&](int s, int l) { return offset[s] + localRoot[s][l] - 1; };
+
+    UnionFind equivalences(offset[numberOfStrips]);
+    equivalences.makeSets(offset[numberOfStrips]);
+
+    // merge the components crossing the boundaries between strips
+    for (int s = 1; s < numberOfStrips; s++) {
+        int i = stripStart[s];
+        if (i == stripStart[s - 1] || i == rows)
+            continue;
+        const uchar* above = binary.ptr<uchar>(i - 1);
+        const uchar* below = binary.ptr<uchar>(i);
+        const int* labelAbove = labels.ptr<int>(i - 1);
+        const int* labelBelow = labels.ptr<int>(i);
+        for (int j = 0; j < cols; j++) {
+            if (below[j] == 0)
+                continue;
+            if (connectivity == 8) {
+                for (int k = std::max(j - 1, 0); k <= std::min(j + 1, cols - 1); k++) {
+                    if (above[k] != 0)
+                        equivalences.merge(globalLabel(s - 1, labelAbove[k]), globalLabel(s, labelBelow[j]));
+                }
+                continue;
+            }
+            // already merged through the previous column
+            if (above[j] == 0 || (j > 0 && above[j - 1] != 0 && below[j - 1] != 0))
+                continue;
+            equivalences.merge(globalLabel(s - 1, labelAbove[j]), globalLabel(s, labelBelow[j]));
+        }
+    }
+
+    // number the components in order of creation: the strips are visited from top to bottom
+    vector<int> number(offset[numberOfStrips], 0);
+    vector<vector<int> > finalLabel(numberOfStrips);
+    numberOfComponents = 0;
+    for (int s = 0; s < numberOfStrips; s++) {
+        finalLabel[s].assign(localRoot[s].size(), 0);
+        for (int l = 1; l < (int)localRoot[s].size(); l++) {
+            int root = equivalences.find(globalLabel(s, l));
+            if (number[root] == 0)
+                number[root] = ++numberOfComponents;
+            finalLabel[s][l] = number[root];
+        }
+    }
+
+    if (numberOfComponents == 0)
+        return Mat::zeros(binary.size(), depth);
+
+    // the raw labels are written in place
+    Mat res = (depth == CV_32S) ? labels : Mat(binary.size(), CV_32FC1);
+    float scale = (float)(1.0 / numberOfComponents);
+    parallel_for_(Range(0, numberOfStrips), [&](const Range& range) {
+        for (int s = range.start; s < range.end; s++) {
+            const int* lut = &finalLabel[s][0];
+            for (int i = stripStart[s]; i < stripStart[s + 1]; i++) {
+                const int* label = labels.ptr<int>(i);
+                if (depth == CV_32S) {
+                    int* dst = res.ptr<int>(i);
+                    for (int j = 0; j < cols; j++)
+                        dst[j] = lut[label[j]];
+                } else {
+                    float* dst = res.ptr<float>(i);
+                    for (int j = 0; j < cols; j++)
+                        dst[j] = lut[label[j]] * scale;
+                }
             }
         }
+    });
+    return res;
+}
+
+cv::Mat ccTwoPassLabelParallel(cv::Mat image, int connectivity)
+{
+    int numberOfComponents;
+    return labelStrips(image, connectivity, CV_32F, numberOfComponents);
+}
+
+/**
+    Labels of ccTwoPassLabelParallel before normalization: CV_32S image, 0 for the background,
+    components numbered from 1 to numberOfComponents.
+*/
+cv::Mat ccTwoPassLabelParallelRaw(cv::Mat image, int& numberOfComponents, int connectivity)
+{
+    return labelStrips(image, connectivity, CV_32S, numberOfComponents);
+}
+
+/**
+    Allocates the arrays for numberOfComponents components, with all the attributes set to 0
+    and empty bounding boxes.
+*/
+void ComponentStats::reset(int numberOfComponents)
+{
+    count = numberOfComponents;
+    int n = numberOfComponents + 1;
+    area.assign(n, 0);
+    left.assign(n, INT_MAX);
+    top.assign(n, INT_MAX);
+    right.assign(n, -1);
+    bottom.assign(n, -1);
+    sumX.assign(n, 0.0);
+    sumY.assign(n, 0.0);
+    sumXX.assign(n, 0.0);
+    sumXY.assign(n, 0.0);
+    sumYY.assign(n, 0.0);
+}
+
+/**
+    Appends a component with all the attributes set to 0 and an empty bounding box,
+    and returns its label.
+*/
+int ComponentStats::add()
+{
+    area.push_back(0);
+    left.push_back(INT_MAX);
+    top.push_back(INT_MAX);
+    right.push_back(-1);
+    bottom.push_back(-1);
+    sumX.push_back(0.0);
+    sumY.push_back(0.0);
+    sumXX.push_back(0.0);
+    sumXY.push_back(0.0);
+    sumYY.push_back(0.0);
+    return ++count;
+}
+
+/**
+    Adds the pixels [start, end) of the row to the component label, the sums of the coordinates
+    over the run are computed in closed form.
+*/
+void ComponentStats::addRun(int label, int row, int start, int end)
+{
+    double length = end - start;
+    double first = start, last = end - 1;
+    double runSumX = (first + last) * length / 2;
+    double runSumXX = (last * (last + 1) * (2 * last + 1) - (first - 1) * first * (2 * first - 1)) / 6;
+    area[label] += end - start;
+    left[label] = std::min(left[label], start);
+    right[label] = std::max(right[label], end - 1);
+    top[label] = std::min(top[label], row);
+    bottom[label] = std::max(bottom[label], row);
+    sumX[label] += runSumX;
+    sumY[label] += (double)row * length;
+    sumXX[label] += runSumXX;
+    sumXY[label] += (double)row * runSumX;
+    sumYY[label] += (double)row * row * length;
+}
+
+/**
+    Adds the attributes of the component otherLabel of other to the component label.
+*/
+void ComponentStats::merge(int label, const ComponentStats& other, int otherLabel)
+{
+    area[label] += other.area[otherLabel];
+    left[label] = std::min(left[label], other.left[otherLabel]);
+    top[label] = std::min(top[label], other.top[otherLabel]);
+    right[label] = std::max(right[label], other.right[otherLabel]);
+    bottom[label] = std::max(bottom[label], other.bottom[otherLabel]);
+    sumX[label] += other.sumX[otherLabel];
+    sumY[label] += other.sumY[otherLabel];
+    sumXX[label] += other.sumXX[otherLabel];
+    sumXY[label] += other.sumXY[otherLabel];
+    sumYY[label] += other.sumYY[otherLabel];
+}
+
+/**
+    Second pass of the 2 pass labeling: replaces the provisional labels by the final ones, numbered
+    from 1 in the raster order of the first pixel of the components, and returns the number of
+    components. The attributes of the components are also computed when stats is not null.
+*/
+static int finalLabels(Mat& labels, UnionFind& equivalences, ComponentStats* stats)
+{
+    int numberOfLabels = equivalences.size();
+    vector<int> rootOf(numberOfLabels), number(numberOfLabels, 0);
+    int numberOfComponents = 0;
+    for (int l = 0; l < numberOfLabels; l++) {
+        rootOf[l] = equivalences.find(l);
+        if (l > 0 && rootOf[l] == l)
+            numberOfComponents++;
     }
 
-    cout << "=== Début des tailles des composants ===" << endl;
-    for (const auto &pair : labelCount) {
-        cout << "Label " << pair.first << " -> Taille : " << pair.second << " pixels" << endl;
+    // components are numbered when their first run is met: provisional labels are not created
+    // in raster order with 8 connectivity
+    if (stats)
+        stats->reset(numberOfComponents);
+    int nextComponent = 0;
+    for (int i = 0; i < labels.rows; i++) {
+        int* label = labels.ptr<int>(i);
+        int j = 0;
+        while (j < labels.cols) {
+            int root = rootOf[label[j]];
+            int start = j;
+            while (j < labels.cols && rootOf[label[j]] == root)
+                j++;
+            if (root == 0)
+                continue;
+            if (number[root] == 0)
+                number[root] = ++nextComponent;
+            int l = number[root];
+            std::fill(label + start, label + j, l);
+            if (stats)
+                stats->addRun(l, i, start, j);
+        }
     }
-    cout << "=== Fin des tailles des composants ===" << endl;
+    return numberOfComponents;
+}
+
+/**
+    Labels the connected components (4 or 8 connectivity) of a binary image and computes their attributes.
+    The components are numbered from 1 in the raster order of their first pixel and the label image
+    (CV_32S, 0 for the background) is returned.
+
+    The first pass is the one of ccTwoPassLabel. The second pass writes the final labels run by run
+    and accumulates the attributes of each run in closed form, so the attributes cost no extra
+    traversal of the image.
+*/
+cv::Mat ccStats(cv::Mat image, ComponentStats& stats, int connectivity)
+{
+    Mat binary = toBinary(image);
+    Mat labels(binary.size(), CV_32SC1);
 
-    Mat res = Mat::zeros(binary.size(), CV_8UC1);
+    UnionFind equivalences(provisionalCapacity(binary, connectivity));
+    equivalences.makeSet();
+    firstPass(binary, labels, equivalences, connectivity);
+    finalLabels(labels, equivalences, &stats);
+    return labels;
+}
+
+/**
+    Performs a labeling of image connected component with 4 or 8 connectivity using a
+    2 pass algorithm, without the normalization of ccTwoPassLabel.
+    Returns the label image (CV_32S, 0 for the background), the components being numbered
+    from 1 to numberOfComponents in the raster order of their first pixel.
+*/
+cv::Mat ccTwoPassLabelRaw(cv::Mat image, int& numberOfComponents, int connectivity)
+{
+    Mat binary = toBinary(image);
+    Mat labels(binary.size(), CV_32SC1);
+
+    UnionFind equivalences(provisionalCapacity(binary, connectivity));
+    equivalences.makeSet();
+    firstPass(binary, labels, equivalences, connectivity);
+    numberOfComponents = finalLabels(labels, equivalences, 0);
+    return labels;
+}
+
+/**
+    Binary image (0 or 255) of the components of the label image (CV_32S) whose entry in selected
+    is non zero. selected is a lookup table over the labels, e.g. built from a ComponentStats:
+    selected[l] = stats.area[l] >= size.
+*/
+cv::Mat ccSelect(cv::Mat labels, const std::vector<uchar>& selected)
+{
+    CV_Assert(labels.type() == CV_32SC1);
+    Mat res(labels.size(), CV_8UC1);
+    int numberOfLabels = (int)selected.size();
     for (int i = 0; i < labels.rows; i++) {
+        const int* label = labels.ptr<int>(i);
+        uchar* dst = res.ptr<uchar>(i);
         for (int j = 0; j < labels.cols; j++) {
-            int label = labels.at<int>(i, j);
-            if (label > 0 && labelCount[label] >= size) {
-                res.at<uchar>(i, j) = 255;
+            int l = label[j];
+            dst[j] = (l > 0 && l < numberOfLabels && selected[l]) ? 255 : 0;
+        }
+    }
+    return res;
+}
+
+RunLengthImage::RunLengthImage(): RunLengthImage(0, 0)
+{
+}
+
+RunLengthImage::RunLengthImage(int rows, int cols): height(rows), width(cols), rowStart(rows + 1, 0)
+{
+}
+
+/**
+    Run length encoding of an unsigned char image or a float image in [0,1],
+    the pixels are present with the same rule as in ccLabel.
+*/
+RunLengthImage::RunLengthImage(Mat image): RunLengthImage(image.rows, image.cols)
+{
+    Mat binary = toBinary(image);
+    for (int i = 0; i < height; i++) {
+        const uchar* row = binary.ptr<uchar>(i);
+        int j = 0;
+        while (j < width) {
+            while (j < width && row[j] == 0)
+                j++;
+            if (j == width)
+                break;
+            Run run = {i, j, j};
+            while (j < width && row[j] != 0)
+                j++;
+            run.end = j;
+            runList.push_back(run);
+        }
+    }
+    indexRows();
+}
+
+/**
+    Computes the first run of each row, the runs being in raster order.
+*/
+void RunLengthImage::indexRows()
+{
+    rowStart.assign(height + 1, 0);
+    for (size_t k = 0; k < runList.size(); k++)
+        rowStart[runList[k].row + 1]++;
+    for (int i = 0; i < height; i++)
+        rowStart[i + 1] += rowStart[i];
+}
+
+/**
+    Unsigned char image with the present pixels set to 255.
+*/
+Mat RunLengthImage::toMat() const
+{
+    Mat res = Mat::zeros(height, width, CV_8UC1);
+    for (const Run& run : runList) {
+        uchar* row = res.ptr<uchar>(run.row);
+        std::fill(row + run.start, row + run.end, 255);
+    }
+    return res;
+}
+
+/**
+    Labels the connected components (4 or 8 connectivity) and returns the label of each run.
+    The components are numbered from 1 in raster order, as in ccLabel.
+
+    Two runs of consecutive rows are connected when their intervals overlap, or touch by
+    a corner with 8 connectivity: the runs
+    of each row are matched with the ones of the previous row in a single merge-like sweep,
+    and the connected runs are merged in a union-find over the runs.
+*/
+vector<int> RunLengthImage::label(int& numberOfComponents, int connectivity) const
+{
+    CV_Assert(connectivity == 4 || connectivity == 8);
+    int reach = (connectivity == 8) ? 1 : 0;
+    int numberOfRuns = (int)runList.size();
+    UnionFind equivalences(numberOfRuns);
+    equivalences.makeSets(numberOfRuns);
+
+    for (int i = 1; i < height; i++) {
+        int above = rowStart[i - 1], aboveEnd = rowStart[i];
+        for (int k = rowStart[i]; k < rowStart[i + 1] && above < aboveEnd; ) {
+            const Run& run = runList[k];
+            const Run& other = runList[above];
+            if (other.end + reach <= run.start) {
+                above++;
+            } else if (run.end + reach <= other.start) {
+                k++;
+            } else {
+                equivalences.merge(k, above);
+                // the run ending first cannot overlap the next run of the other row
+                if (other.end < run.end)
+                    above++;
+                else
+                    k++;
             }
         }
     }
 
-    if (countNonZero(res) == 0) {
-        cerr << "⚠️ Attention : L'image finale est vide après filtrage ! Aucun composant ne dépasse le seuil." << endl;
+    vector<int> number(numberOfRuns, 0), runLabels(numberOfRuns);
+    numberOfComponents = 0;
+    for (int k = 0; k < numberOfRuns; k++) {
+        int root = equivalences.find(k);
+        if (number[root] == 0)
+            number[root] = ++numberOfComponents;
+        runLabels[k] = number[root];
+    }
+    return runLabels;
+}
+
+/**
+    Label image (CV_32S, 0 for the background) from the labels of the runs.
+*/
+Mat RunLengthImage::labelImage(const vector<int>& runLabels) const
+{
+    CV_Assert(runLabels.size() == runList.size());
+    Mat res = Mat::zeros(height, width, CV_32SC1);
+    for (size_t k = 0; k < runList.size(); k++) {
+        int* row = res.ptr<int>(runList[k].row);
+        std::fill(row + runList[k].start, row + runList[k].end, runLabels[k]);
+    }
+    return res;
+}
+
+/**
+    Deletes the connected components (4 or 8 connectivity) containing less than size pixels.
+*/
+RunLengthImage RunLengthImage::areaFilter(int size, int connectivity) const
+{
+    int numberOfComponents;
+    vector<int> runLabels = label(numberOfComponents, connectivity);
+    vector<int> area(numberOfComponents + 1, 0);
+    for (size_t k = 0; k < runList.size(); k++)
+        area[runLabels[k]] += runList[k].end - runList[k].start;
+
+    RunLengthImage res(height, width);
+    for (size_t k = 0; k < runList.size(); k++) {
+        if (area[runLabels[k]] >= size)
+            res.runList.push_back(runList[k]);
     }
+    res.indexRows();
+    return res;
+}
 
-    imwrite("filtered.png", res);
-    cout << "✅ Image filtrée enregistrée sous 'filtered.png'" << endl;
+/**
+    Image whose present pixels are the absent pixels of this image.
+*/
+RunLengthImage RunLengthImage::complement() const
+{
+    RunLengthImage res(height, width);
+    for (int i = 0; i < height; i++) {
+        int start = 0;
+        for (int k = rowStart[i]; k < rowStart[i + 1]; k++) {
+            if (runList[k].start > start) {
+                Run gap = {i, start, runList[k].start};
+                res.runList.push_back(gap);
+            }
+            start = runList[k].end;
+        }
+        if (start < width) {
+            Run gap = {i, start, width};
+            res.runList.push_back(gap);
+        }
+    }
+    res.indexRows();
+    return res;
+}
+
+/**
+    Dilation by the rectangle of (2*radiusX+1) x (2*radiusY+1) pixels centered on the origin,
+    pixels outside the image are supposed to be absent.
 
-    imshow("Filtered Image", res);
-    waitKey(0);
-    destroyAllWindows();
+    Each run is first widened by radiusX, then the runs of the row i of the result are the union
+    of the widened runs of the rows i-radiusY to i+radiusY, computed by sorting and merging their
+    intervals.
+*/
+RunLengthImage RunLengthImage::dilate(int radiusX, int radiusY) const
+{
+    CV_Assert(radiusX >= 0 && radiusY >= 0);
+    RunLengthImage res(height, width);
+    vector<std::pair<int, int> > intervals;
+    for (int i = 0; i < height; i++) {
+        intervals.clear();
+        int first = rowStart[std::max(i - radiusY, 0)];
+        int last = rowStart[std::min(i + radiusY + 1, height)];
+        for (int k = first; k < last; k++) {
+            intervals.push_back(std::make_pair(std::max(runList[k].start - radiusX, 0),
+                                               std::min(runList[k].end + radiusX, width)));
+        }
+        if (radiusY > 0)
+            std::sort(intervals.begin(), intervals.end());
 
+        size_t k = 0;
+        while (k < intervals.size()) {
+            Run run = {i, intervals[k].first, intervals[k].second};
+            for (k++; k < intervals.size() && intervals[k].first <= run.end; k++)
+                run.end = std::max(run.end, intervals[k].second);
+            res.runList.push_back(run);
+        }
+    }
+    res.indexRows();
     return res;
 }
 
+/**
+    Erosion by the rectangle of (2*radiusX+1) x (2*radiusY+1) pixels centered on the origin,
+    pixels outside the image are supposed to be present.
+    It is computed as the complement of the dilation of the complement.
+*/
+RunLengthImage RunLengthImage::erode(int radiusX, int radiusY) const
+{
+    return complement().dilate(radiusX, radiusY).complement();
+}
 
+StreamingLabeler::StreamingLabeler(int cols, int connectivity):
+    width(cols), reach(connectivity == 8 ? 1 : 0), currentRow(0), numberOfIds(0)
+{
+    CV_Assert(connectivity == 4 || connectivity == 8);
+    // the slot 0 is unused, as the background of a ComponentStats
+    slots.reset(0);
+    slotParent.assign(1, 0);
+    lastRow.assign(1, -1);
+    slotId.assign(1, 0);
+}
 
 /**
-    Performs a labeling of image connected component with 4 connectivity using a
-    2 pass algorithm.
-    Any non zero pixel of the image is considered as present.
+    Number of components that can still grow, i.e. having pixels in the last row.
 */
-cv::Mat ccTwoPassLabel(cv::Mat image)
+int StreamingLabeler::numberOfActiveComponents() const
 {
-    std::cout << "Starting ccTwoPassLabel..." << std::endl;
+    return slots.count - (int)freeSlots.size();
+}
 
-    Mat binary;
-    if(image.depth() == CV_32F) {
-        image = image * 255;
-        image.convertTo(binary, CV_8UC1);
+int StreamingLabeler::newSlot()
+{
+    int slot;
+    if (freeSlots.empty()) {
+        slot = slots.add();
+        slotParent.push_back(slot);
+        lastRow.push_back(-1);
+        slotId.push_back(0);
     } else {
-        image.copyTo(binary);
+        slot = freeSlots.back();
+        freeSlots.pop_back();
+        slots.area[slot] = 0;
+        slots.left[slot] = slots.top[slot] = INT_MAX;
+        slots.right[slot] = slots.bottom[slot] = -1;
+        slots.sumX[slot] = slots.sumY[slot] = slots.sumXX[slot] = slots.sumXY[slot] = slots.sumYY[slot] = 0.0;
+        slotParent[slot] = slot;
     }
-    threshold(binary, binary, 127, 255, THRESH_BINARY);
+    slotId[slot] = ++numberOfIds;
+    return slot;
+}
 
-    Mat labels = Mat::zeros(binary.size(), CV_32SC1);
-    int currentLabel = 1;
-    std::map<int, int> parent;
+int StreamingLabeler::findSlot(int slot)
+{
+    while (slotParent[slot] != slot) {
+        slotParent[slot] = slotParent[slotParent[slot]];
+        slot = slotParent[slot];
+    }
+    return slot;
+}
 
-    auto findRoot = [&](int label) {
-        while (parent[label] != label) {
-            parent[label] = parent[parent[label]];
-            label = parent[label];
-        }
-        return label;
-    };
+/**
+    Labels the next row of the image (1 x cols, unsigned char or float in [0,1], with the same
+    rule as ccLabel for the present pixels). finished receives the components that have no pixel
+    in this row, and thus cannot grow anymore, numbered from 1 in the order of their leftmost run
+    in the previous row.
 
-    std::cout << "First pass..." << std::endl;
-    for (int i = 0; i < binary.rows; i++) {
-        for (int j = 0; j < binary.cols; j++) {
-            if (binary.at<uchar>(i, j) != 0) {
-                int left = (j > 0) ? labels.at<int>(i, j - 1) : 0;
-                int above = (i > 0) ? labels.at<int>(i - 1, j) : 0;
-
-                if (left == 0 && above == 0) {
-                    labels.at<int>(i, j) = currentLabel;
-                    parent[currentLabel] = currentLabel;
-                    currentLabel++;
-                } else if (left != 0 && above == 0) {
-                    labels.at<int>(i, j) = findRoot(left);
-                } else if (left == 0 && above != 0) {
-                    labels.at<int>(i, j) = findRoot(above);
-                } else { 
-                    int minLabel = std::min(findRoot(left), findRoot(above));
-                    int maxLabel = std::max(findRoot(left), findRoot(above));
-
-                    labels.at<int>(i, j) = minLabel;
-                    parent[maxLabel] = minLabel;
-                }
+    The runs of the row are matched with the runs of the previous row with the sweep of
+    RunLengthImage::label. Each component is a slot of accumulated attributes; the slots of merged
+    components are released at the end of the row, as are the slots of the finished components,
+    so the memory only depends on the width of the image and on the number of active components.
+*/
+void StreamingLabeler::pushRow(Mat row, ComponentStats& finished)
+{
+    processRow(row, finished, nullptr);
+}
+
+/**
+    Same as pushRow(row, finished), rowIds (1 x cols, CV_32S) also receiving the identifier of the
+    component of each pixel of the row (0 for the background). The identifiers are unique over the
+    image; with finishedIds and mergedIds they allow rebuilding the label image, e.g. for checking.
+*/
+void StreamingLabeler::pushRow(Mat row, ComponentStats& finished, Mat& rowIds)
+{
+    processRow(row, finished, &rowIds);
+}
+
+void StreamingLabeler::processRow(Mat row, ComponentStats& finished, Mat* rowIds)
+{
+    CV_Assert(row.rows == 1 && row.cols == width);
+    Mat binary = toBinary(row);
+    const uchar* present = binary.ptr<uchar>(0);
+
+    currentRuns.clear();
+    int j = 0;
+    while (j < width) {
+        while (j < width && present[j] == 0)
+            j++;
+        if (j == width)
+            break;
+        Segment run = {j, j, -1};
+        while (j < width && present[j] != 0)
+            j++;
+        run.end = j;
+        currentRuns.push_back(run);
+    }
+
+    mergedSlots.clear();
+    lastMergedIds.clear();
+    size_t above = 0;
+    for (size_t k = 0; k < currentRuns.size(); k++) {
+        Segment& run = currentRuns[k];
+        while (above < previousRuns.size() && previousRuns[above].end + reach <= run.start)
+            above++;
+        // the runs of the previous row touching the run
+        for (size_t other = above; other < previousRuns.size() && previousRuns[other].start < run.end + reach; other++) {
+            int slot = findSlot(previousRuns[other].slot);
+            if (run.slot < 0) {
+                run.slot = slot;
+            } else if (slot != run.slot) {
+                slots.merge(run.slot, slots, slot);
+                slotParent[slot] = run.slot;
+                mergedSlots.push_back(slot);
+                lastMergedIds.push_back(std::make_pair(slotId[slot], slotId[run.slot]));
             }
         }
+        if (run.slot < 0)
+            run.slot = newSlot();
+        slots.addRun(run.slot, currentRow, run.start, run.end);
+        lastRow[run.slot] = currentRow;
     }
 
-    std::cout << "Union-Find full propagation..." << std::endl;
-    for (auto &p : parent) {
-        p.second = findRoot(p.first);
+    // a component merged after one of its runs was matched is found through its root
+    for (size_t k = 0; k < currentRuns.size(); k++) {
+        currentRuns[k].slot = findSlot(currentRuns[k].slot);
+        lastRow[currentRuns[k].slot] = currentRow;
+    }
+    if (rowIds) {
+        rowIds->create(1, width, CV_32SC1);
+        int* ids = rowIds->ptr<int>(0);
+        std::fill(ids, ids + width, 0);
+        for (size_t k = 0; k < currentRuns.size(); k++)
+            std::fill(ids + currentRuns[k].start, ids + currentRuns[k].end, slotId[currentRuns[k].slot]);
     }
 
-    std::cout << "Second pass..." << std::endl;
-    int maxLabel = 0; 
-    for (int i = 0; i < labels.rows; i++) {
-        for (int j = 0; j < labels.cols; j++) {
-            int label = labels.at<int>(i, j);
-            if (label != 0) {
-                labels.at<int>(i, j) = findRoot(label);
-                maxLabel = std::max(maxLabel, labels.at<int>(i, j));
+    finished.reset(0);
+    lastFinishedIds.clear();
+    for (size_t k = 0; k < previousRuns.size(); k++) {
+        int slot = findSlot(previousRuns[k].slot);
+        if (lastRow[slot] == currentRow)
+            continue;
+        finished.merge(finished.add(), slots, slot);
+        lastFinishedIds.push_back(slotId[slot]);
+        lastRow[slot] = currentRow;
+        freeSlots.push_back(slot);
+    }
+    freeSlots.insert(freeSlots.end(), mergedSlots.begin(), mergedSlots.end());
+
+    previousRuns.swap(currentRuns);
+    currentRow++;
+}
+
+/**
+    Ends the image: finished receives all the active components, numbered from 1 in the order
+    of their leftmost run in the last row. The labeler can then be used for a new image.
+*/
+void StreamingLabeler::finish(ComponentStats& finished)
+{
+    finished.reset(0);
+    lastFinishedIds.clear();
+    lastMergedIds.clear();
+    for (size_t k = 0; k < previousRuns.size(); k++) {
+        int slot = findSlot(previousRuns[k].slot);
+        if (lastRow[slot] == currentRow)
+            continue;
+        finished.merge(finished.add(), slots, slot);
+        lastFinishedIds.push_back(slotId[slot]);
+        lastRow[slot] = currentRow;
+    }
+    previousRuns.clear();
+    slots.reset(0);
+    slotParent.assign(1, 0);
+    lastRow.assign(1, -1);
+    slotId.assign(1, 0);
+    freeSlots.clear();
+    currentRow = 0;
+    numberOfIds = 0;
+}
+
+/**
+    Builds the max-tree of an unsigned char image or a float image in [0,1] (quantized on 256 levels)
+    with 4 or 8 connectivity.
+
+    The pixels are sorted by decreasing level with a counting sort over the 256 levels, then
+    processed in this order: each pixel becomes the parent of the partial trees of its already
+    processed neighbours, found with a union-find. Finally each pixel is linked to the node of its
+    own level (canonical parent), and the attributes are accumulated from the leaves to the root
+    in a single pass over the sorted pixels.
+*/
+MaxTree::MaxTree(Mat image, int connectivity): height(image.rows), width(image.cols)
+{
+    CV_Assert(image.channels() == 1 && (connectivity == 4 || connectivity == 8));
+    Mat gray;
+    if (image.depth() == CV_32F)
+        image.convertTo(gray, CV_8U, 255);
+    else
+        image.convertTo(gray, CV_8U);
+
+    int n = height * width;
+    level.resize(n);
+    for (int i = 0; i < height; i++) {
+        const uchar* row = gray.ptr<uchar>(i);
+        std::copy(row, row + width, level.begin() + i * width);
+    }
+
+    // counting sort by decreasing level, pixels of the same level stay in raster order
+    vector<int> first(257, 0);
+    for (int p = 0; p < n; p++)
+        first[256 - level[p]]++;
+    for (int l = 0; l < 256; l++)
+        first[l + 1] += first[l];
+    order.resize(n);
+    for (int p = 0; p < n; p++)
+        order[first[255 - level[p]]++] = p;
+
+    const int di[8] = {-1, 0, 0, 1, -1, -1, 1, 1};
+    const int dj[8] = {0, -1, 1, 0, -1, 1, -1, 1};
+    parent.resize(n);
+    vector<int> representative(n);
+    vector<uchar> processed(n, 0);
+    UnionFind partialTrees(n);
+    partialTrees.makeSets(n);
+    for (int k = 0; k < n; k++) {
+        int p = order[k];
+        int i = p / width, j = p % width;
+        parent[p] = p;
+        representative[p] = p;
+        processed[p] = 1;
+        for (int d = 0; d < connectivity; d++) {
+            int ni = i + di[d], nj = j + dj[d];
+            if (ni < 0 || ni >= height || nj < 0 || nj >= width)
+                continue;
+            int q = ni * width + nj;
+            if (!processed[q])
+                continue;
+            int root = representative[partialTrees.find(q)];
+            if (root != p) {
+                parent[root] = p;
+                representative[partialTrees.merge(p, q)] = p;
             }
         }
     }
 
-    if (maxLabel == 0) {
-        std::cerr << "Error: All labels are zero. Check input image and labeling process." << std::endl;
-        return Mat::zeros(binary.size(), CV_32FC1);
+    // canonical parents, from the root to the leaves
+    for (int k = n - 1; k >= 0; k--) {
+        int p = order[k];
+        int q = parent[p];
+        if (level[parent[q]] == level[q])
+            parent[p] = parent[q];
     }
 
-    std::cout << "Normalizing labels..." << std::endl;
-    Mat normalized;
-    labels.convertTo(normalized, CV_32FC1);
-    normalized /= maxLabel;
+    area.assign(n, 1);
+    maxLevel = level;
+    sumOfLevels.assign(level.begin(), level.end());
+    for (int k = 0; k < n; k++) {
+        int p = order[k], q = parent[p];
+        if (q == p)
+            continue;
+        area[q] += area[p];
+        maxLevel[q] = std::max(maxLevel[q], maxLevel[p]);
+        sumOfLevels[q] += sumOfLevels[p];
+    }
+}
 
-    std::cout << "ccTwoPassLabel completed." << std::endl;
-    return normalized;
+/**
+    Number of nodes of the tree, i.e. of distinct components of the upper level sets.
+*/
+int MaxTree::numberOfNodes() const
+{
+    int count = 0;
+    for (size_t p = 0; p < parent.size(); p++)
+        count += (parent[p] == (int)p || level[parent[p]] != level[p]);
+    return count;
+}
+
+double MaxTree::attributeValue(Attribute attribute, int node) const
+{
+    int parentLevel = level[parent[node]];
+    switch (attribute) {
+    case Area:
+        return area[node];
+    case Height:
+        return maxLevel[node] - parentLevel;
+    case Volume:
+        return sumOfLevels[node] - (double)area[node] * parentLevel;
+    }
+    return 0;
+}
+
+/**
+    Attribute filter with the direct rule: the nodes whose attribute is lower than threshold are
+    removed and their pixels take the level of the closest remaining ancestor. The root is always
+    kept. The attributes are increasing, so this is the attribute opening (e.g. the area opening:
+    the pixels of each component of an upper level set with less than threshold pixels are lowered).
+
+    The result (unsigned char image) is computed in a single pass from the root to the leaves.
+*/
+Mat MaxTree::filter(Attribute attribute, double threshold) const
+{
+    Mat res(height, width, CV_8UC1);
+    if (order.empty())
+        return res;
+    uchar* out = res.ptr<uchar>(0);
+    for (int k = (int)order.size() - 1; k >= 0; k--) {
+        int p = order[k], q = parent[p];
+        if (q == p)
+            out[p] = level[p];
+        else if (level[q] == level[p])
+            out[p] = out[q];
+        else
+            out[p] = attributeValue(attribute, p) >= threshold ? level[p] : out[q];
+    }
+    return res;
 }
@@ -2,9 +2,175 @@
 #pragma once
 
 #include <opencv2/opencv.hpp>
+#include <vector>
+#include <utility>
 
-cv::Mat ccLabel(cv::Mat image);
+/**
+    Attributes of the connected components of a label image, stored in flat arrays
+    indexed by label: the component l (from 1 to count) is at index l, index 0 is the background.
+    The bounding box is [left, right] x [top, bottom] and the sums are the raw moments
+    of the pixel coordinates (x: column, y: row).
+*/
+struct ComponentStats
+{
+    int count;
+    std::vector<int> area;
+    std::vector<int> left, top, right, bottom;
+    std::vector<double> sumX, sumY, sumXX, sumXY, sumYY;
 
-cv::Mat ccAreaFilter(cv::Mat image, int size);
+    void reset(int numberOfComponents);
+    int add();
+    void addRun(int label, int row, int start, int end);
+    void merge(int label, const ComponentStats& other, int otherLabel);
 
-cv::Mat ccTwoPassLabel(cv::Mat image);
\ No newline at end of file
+    double centroidX(int label) const { return sumX[label] / area[label]; }
+    double centroidY(int label) const { return sumY[label] / area[label]; }
+
+    // second order central moments, normalized by the area
+    double varianceX(int label) const { return sumXX[label] / area[label] - centroidX(label) * centroidX(label); }
+    double varianceY(int label) const { return sumYY[label] / area[label] - centroidY(label) * centroidY(label); }
+    double covarianceXY(int label) const { return sumXY[label] / area[label] - centroidX(label) * centroidY(label); }
+};
+
+/**
+    Binary image stored as the list of its runs: maximal horizontal intervals of present pixels.
+    The runs are sorted in raster order, the runs of the row i are [firstRun(i), firstRun(i+1)).
+    The operators work on the runs, their cost depends on the number of runs and not on the
+    number of pixels.
+*/
+class RunLengthImage
+{
+public:
+    // pixels [start, end) of the row
+    struct Run
+    {
+        int row, start, end;
+    };
+
+    RunLengthImage();
+    explicit RunLengthImage(cv::Mat image);
+
+    int rows() const { return height; }
+    int cols() const { return width; }
+    const std::vector<Run>& runs() const { return runList; }
+    int firstRun(int row) const { return rowStart[row]; }
+
+    cv::Mat toMat() const;
+
+    std::vector<int> label(int& numberOfComponents, int connectivity = 4) const;
+    cv::Mat labelImage(const std::vector<int>& runLabels) const;
+
+    RunLengthImage areaFilter(int size, int connectivity = 4) const;
+    RunLengthImage complement() const;
+    RunLengthImage dilate(int radiusX, int radiusY) const;
+    RunLengthImage erode(int radiusX, int radiusY) const;
+
+private:
+    RunLengthImage(int rows, int cols);
+    void indexRows();
+
+    int height, width;
+    std::vector<Run> runList;
+    std::vector<int> rowStart;
+};
+
+/**
+    One-pass connected component labeling of a binary image received row by row, e.g. from a
+    scanner or a line-scan camera: only the runs of the last row and the attributes of the
+    components still active are kept, so the memory does not depend on the height of the image.
+    The components are returned with their attributes as soon as they cannot grow anymore.
+*/
+class StreamingLabeler
+{
+public:
+    explicit StreamingLabeler(int cols, int connectivity = 4);
+
+    void pushRow(cv::Mat row, ComponentStats& finished);
+    void pushRow(cv::Mat row, ComponentStats& finished, cv::Mat& rowIds);
+    void finish(ComponentStats& finished);
+
+    int rowsRead() const { return currentRow; }
+    int numberOfActiveComponents() const;
+
+    // identifiers of the components finished by the last pushRow or finish, in the order of finished
+    const std::vector<int>& finishedIds() const { return lastFinishedIds; }
+    // (merged, into) identifiers of the components merged by the last pushRow
+    const std::vector<std::pair<int, int> >& mergedIds() const { return lastMergedIds; }
+
+private:
+    // pixels [start, end) of a row, belonging to the component slot
+    struct Segment
+    {
+        int start, end, slot;
+    };
+
+    void processRow(cv::Mat row, ComponentStats& finished, cv::Mat* rowIds);
+    int newSlot();
+    int findSlot(int slot);
+
+    int width, reach, currentRow, numberOfIds;
+    std::vector<Segment> previousRuns, currentRuns;
+    // attributes of the active components, indexed by slot, and union-find over the slots
+    ComponentStats slots;
+    std::vector<int> slotParent, lastRow;
+    std::vector<int> freeSlots, mergedSlots;
+    // identifier of the component of each slot, never reused
+    std::vector<int> slotId;
+    std::vector<int> lastFinishedIds;
+    std::vector<std::pair<int, int> > lastMergedIds;
+};
+
+/**
+    Max-tree (component tree) of a grayscale image: its nodes are the connected components of the
+    upper level sets {f >= t} for all the thresholds t, the parent of a node being the smallest
+    component of a lower threshold containing it. The tree is built once and can then be filtered
+    at any attribute threshold.
+*/
+class MaxTree
+{
+public:
+    enum Attribute
+    {
+        Area,   // number of pixels
+        Height, // highest level of the component minus the level of its parent
+        Volume  // sum over the pixels of their level minus the level of the parent
+    };
+
+    explicit MaxTree(cv::Mat image, int connectivity = 4);
+
+    int numberOfNodes() const;
+
+    cv::Mat filter(Attribute attribute, double threshold) const;
+
+private:
+    double attributeValue(Attribute attribute, int node) const;
+
+    int height, width;
+    std::vector<uchar> level;
+    // pixels sorted by decreasing level, parents come after their children
+    std::vector<int> order;
+    // parent[p] is the node of p when p is not a node, otherwise the parent node of p
+    std::vector<int> parent;
+    // attributes of the nodes, indexed by pixel
+    std::vector<int> area;
+    std::vector<uchar> maxLevel;
+    std::vector<double> sumOfLevels;
+};
+
+cv::Mat ccLabel(cv::Mat image, int connectivity = 4);
+
+cv::Mat ccLabelRaw(cv::Mat image, int& numberOfComponents, int connectivity = 4);
+
+cv::Mat ccAreaFilter(cv::Mat image, int size, int connectivity = 8);
+
+cv::Mat ccTwoPassLabel(cv::Mat image, int connectivity = 4);
+
+cv::Mat ccTwoPassLabelRaw(cv::Mat image, int& numberOfComponents, int connectivity = 4);
+
+cv::Mat ccTwoPassLabelParallel(cv::Mat image, int connectivity = 4);
+
+cv::Mat ccTwoPassLabelParallelRaw(cv::Mat image, int& numberOfComponents, int connectivity = 4);
+
+cv::Mat ccStats(cv::Mat image, ComponentStats& stats, int connectivity = 4);
+
+cv::Mat ccSelect(cv::Mat labels, const std::vector<uchar>& selected);
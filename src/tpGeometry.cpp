@@ -2,44 +2,272 @@
 #include <cmath>
 #include <algorithm>
 #include <tuple>
+#include <vector>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 using namespace cv;
 using namespace std;
 
+/**
+    Element of N bytes (a pixel with all its channels), copied as a whole.
+*/
+template<int N>
+struct Element
+{
+    uchar bytes[N];
+};
+
+/**
+    Transposes the rows x cols block of elements T at src into dst: dst(j, i) = src(i, j).
+*/
+template<typename T>
+static void transposeBlockScalar(const uchar* src, size_t srcStep, uchar* dst, size_t dstStep, int rows, int cols)
+{
+    for (int i = 0; i < rows; i++) {
+        const T* srcRow = (const T*)(src + i * srcStep);
+        for (int j = 0; j < cols; j++)
+            *(T*)(dst + j * dstStep + i * sizeof(T)) = srcRow[j];
+    }
+}
+
+/**
+    Transposition of the full size x size blocks, the micro-kernel of the tiled transposition.
+*/
+template<typename T>
+struct BlockTranspose
+{
+    static const int size = 8;
+
+    static void full(const uchar* src, size_t srcStep, uchar* dst, size_t dstStep)
+    {
+        transposeBlockScalar<T>(src, srcStep, dst, dstStep, size, size);
+    }
+};
+
+#if defined(__SSE2__)
+/**
+    16x16 bytes (8 bits single channel) transposed in registers by 4 stages of interleaving
+    of 8, 16, 32 and 64 bits.
+*/
+template<>
+struct BlockTranspose<Element<1> >
+{
+    static const int size = 16;
+
+    static void full(const uchar* src, size_t srcStep, uchar* dst, size_t dstStep)
+    {
+        __m128i a[16], b[16];
+        for (int i = 0; i < 16; i++)
+            a[i] = _mm_loadu_si128((const __m128i*)(src + i * srcStep));
+        for (int i = 0; i < 16; i += 2) {
+            b[i] = _mm_unpacklo_epi8(a[i], a[i + 1]);
+            b[i + 1] = _mm_unpackhi_epi8(a[i], a[i + 1]);
+        }
+        for (int i = 0; i < 16; i += 4) {
+            a[i] = _mm_unpacklo_epi16(b[i], b[i + 2]);
+            a[i + 1] = _mm_unpackhi_epi16(b[i], b[i + 2]);
+            a[i + 2] = _mm_unpacklo_epi16(b[i + 1], b[i + 3]);
+            a[i + 3] = _mm_unpackhi_epi16(b[i + 1], b[i + 3]);
+        }
+        for (int i = 0; i < 16; i += 8) {
+            for (int k = 0; k < 4; k++) {
+                b[i + 2 * k] = _mm_unpacklo_epi32(a[i + k], a[i + k + 4]);
+                b[i + 2 * k + 1] = _mm_unpackhi_epi32(a[i + k], a[i + k + 4]);
+            }
+        }
+        for (int k = 0; k < 8; k++) {
+            _mm_storeu_si128((__m128i*)(dst + 2 * k * dstStep), _mm_unpacklo_epi64(b[k], b[k + 8]));
+            _mm_storeu_si128((__m128i*)(dst + (2 * k + 1) * dstStep), _mm_unpackhi_epi64(b[k], b[k + 8]));
+        }
+    }
+};
+
+/**
+    8x8 elements of 4 bytes (float single channel or 8 bits 4 channels) transposed in registers
+    as four 4x4 blocks.
+*/
+template<>
+struct BlockTranspose<Element<4> >
+{
+    static const int size = 8;
+
+    static void full(const uchar* src, size_t srcStep, uchar* dst, size_t dstStep)
+    {
+        for (int bi = 0; bi < 8; bi += 4) {
+            for (int bj = 0; bj < 8; bj += 4) {
+                const uchar* s = src + bi * srcStep + bj * 4;
+                __m128i r0 = _mm_loadu_si128((const __m128i*)s);
+                __m128i r1 = _mm_loadu_si128((const __m128i*)(s + srcStep));
+                __m128i r2 = _mm_loadu_si128((const __m128i*)(s + 2 * srcStep));
+                __m128i r3 = _mm_loadu_si128((const __m128i*)(s + 3 * srcStep));
+                __m128i t0 = _mm_unpacklo_epi32(r0, r1);
+                __m128i t1 = _mm_unpacklo_epi32(r2, r3);
+                __m128i t2 = _mm_unpackhi_epi32(r0, r1);
+                __m128i t3 = _mm_unpackhi_epi32(r2, r3);
+                uchar* d = dst + bj * dstStep + bi * 4;
+                _mm_storeu_si128((__m128i*)d, _mm_unpacklo_epi64(t0, t1));
+                _mm_storeu_si128((__m128i*)(d + dstStep), _mm_unpackhi_epi64(t0, t1));
+                _mm_storeu_si128((__m128i*)(d + 2 * dstStep), _mm_unpacklo_epi64(t2, t3));
+                _mm_storeu_si128((__m128i*)(d + 3 * dstStep), _mm_unpackhi_epi64(t2, t3));
+            }
+        }
+    }
+};
+#endif
+
+template<typename T>
+static void transposeBlock(const uchar* src, size_t srcStep, uchar* dst, size_t dstStep, int rows, int cols)
+{
+    if (rows == BlockTranspose<T>::size && cols == BlockTranspose<T>::size)
+        BlockTranspose<T>::full(src, srcStep, dst, dstStep);
+    else
+        transposeBlockScalar<T>(src, srcStep, dst, dstStep, rows, cols);
+}
+
+// side of the tiles in elements, a multiple of the block sizes: a source tile and a destination
+// tile of 64x64 elements stay in the L2 cache
+static const int transposeTile = 64;
+
+/**
+    Transposition of src into dst by tiles, each tile being transposed by blocks.
+*/
+template<typename T>
+static void transposeTiled(const Mat& src, Mat& dst)
+{
+    const int block = BlockTranspose<T>::size;
+    for (int ti = 0; ti < src.rows; ti += transposeTile) {
+        for (int tj = 0; tj < src.cols; tj += transposeTile) {
+            int tileRows = std::min(ti + transposeTile, src.rows), tileCols = std::min(tj + transposeTile, src.cols);
+            for (int i = ti; i < tileRows; i += block) {
+                for (int j = tj; j < tileCols; j += block) {
+                    transposeBlock<T>(src.ptr(i) + j * sizeof(T), src.step, dst.ptr(j) + i * sizeof(T), dst.step,
+                                      std::min(block, src.rows - i), std::min(block, src.cols - j));
+                }
+            }
+        }
+    }
+}
+
+/**
+    In-place transposition of a square image: the blocks above the diagonal are swapped with their
+    symmetric blocks below it, through a buffer of one block.
+*/
+template<typename T>
+static void transposeSquareInPlace(Mat& image)
+{
+    const int block = BlockTranspose<T>::size;
+    T buffer[block * block];
+    const size_t bufferStep = block * sizeof(T);
+    int n = image.rows;
+    for (int ti = 0; ti < n; ti += transposeTile) {
+        for (int tj = ti; tj < n; tj += transposeTile) {
+            int tileRows = std::min(ti + transposeTile, n), tileCols = std::min(tj + transposeTile, n);
+            for (int i = ti; i < tileRows; i += block) {
+                for (int j = (ti == tj) ? i : tj; j < tileCols; j += block) {
+                    int rows = std::min(block, n - i), cols = std::min(block, n - j);
+                    uchar* a = image.ptr(i) + j * sizeof(T);
+                    uchar* b = image.ptr(j) + i * sizeof(T);
+                    transposeBlock<T>(a, image.step, (uchar*)buffer, bufferStep, rows, cols);
+                    if (i != j)
+                        transposeBlock<T>(b, image.step, a, image.step, cols, rows);
+                    for (int r = 0; r < cols; r++)
+                        std::copy(buffer + r * block, buffer + r * block + rows, (T*)(b + r * image.step));
+                }
+            }
+        }
+    }
+}
+
+template<typename T>
+static void transposeElements(Mat src, Mat dst)
+{
+    if (src.data == dst.data)
+        transposeSquareInPlace<T>(src);
+    else
+        transposeTiled<T>(src, dst);
+}
+
+/**
+    Transposes src into dst (in place when they share their data), whatever the type of the
+    elements: only their size matters.
+*/
+static void transposeAnyType(Mat src, Mat dst)
+{
+    switch (src.elemSize()) {
+    case 1: transposeElements<Element<1> >(src, dst); break;
+    case 2: transposeElements<Element<2> >(src, dst); break;
+    case 3: transposeElements<Element<3> >(src, dst); break;
+    case 4: transposeElements<Element<4> >(src, dst); break;
+    case 6: transposeElements<Element<6> >(src, dst); break;
+    case 8: transposeElements<Element<8> >(src, dst); break;
+    case 12: transposeElements<Element<12> >(src, dst); break;
+    case 16: transposeElements<Element<16> >(src, dst); break;
+    default: CV_Error(Error::StsUnsupportedFormat, "transpose: unsupported element size");
+    }
+}
+
 /**
     Transpose the input image,
     ie. performs a planar symmetry according to the
     first diagonal (upper left to lower right corner).
+
+    Works with any number of channels of 8 bits or float values (and any type with elements of
+    1, 2, 3, 4, 6, 8, 12 or 16 bytes). The image is transposed by tiles for the cache, each tile
+    by blocks transposed in registers (16x16 for 8 bits single channel, 8x8 for 4 bytes elements)
+    when SSE2 is available.
 */
 Mat transpose(Mat image)
 {
-    Mat res = Mat::zeros(1,1,CV_32FC1);
-    /********************************************
-                YOUR CODE HERE
-    hint: consider a non square image
-    *********************************************/
-   
-    /********************************************
-                END OF YOUR CODE
-    *********************************************/
+    Mat res(image.cols, image.rows, image.type());
+    transposeAnyType(image, res);
     return res;
 }
 
+/**
+    Transposes a square image in place.
+*/
+void transposeInPlace(Mat image)
+{
+    CV_Assert(image.rows == image.cols);
+    transposeAnyType(image, image);
+}
+
+/**
+    Interpolation through a function pointer, for the function pointer interface.
+*/
+struct FunctionInterpolation
+{
+    float(* function)(Mat image, float y, float x);
+
+    float operator()(const Mat& image, float y, float x) const
+    {
+        return function(image, y, x);
+    }
+};
+
+void interpolateRow(const Mat& image, const float* y, const float* x, float* values, int n, NearestInterpolation interpolation)
+{
+    interpolateRowWith(image, y, x, values, n, interpolation);
+}
+
+void interpolateRow(const Mat& image, const float* y, const float* x, float* values, int n, BilinearInterpolation interpolation)
+{
+    interpolateRowWith(image, y, x, values, n, interpolation);
+}
+
+void interpolateRow(const Mat& image, const float* y, const float* x, float* values, int n, BicubicInterpolation interpolation)
+{
+    interpolateRowWith(image, y, x, values, n, interpolation);
+}
+
 /**
     Compute the value of a nearest neighbour interpolation
     in image Mat at position (x,y)
 */
 float interpolate_nearest(Mat image, float y, float x)
 {
-    float v=0;
-    /********************************************
-                YOUR CODE HERE
-    *********************************************/
-    
-    /********************************************
-                END OF YOUR CODE
-    *********************************************/
-    return v;
-
+    return NearestInterpolation()(image, y, x);
 }
 
 
@@ -48,33 +276,184 @@ float interpolate_nearest(Mat image, float y, float x)
 */
 float interpolate_bilinear(Mat image, float y, float x)
 {
-    float v=0;
-    /********************************************
-                YOUR CODE HERE
-    *********************************************/
-    
-    /********************************************
-                END OF YOUR CODE
-    *********************************************/
-    return v;
+    return BilinearInterpolation()(image, y, x);
+}
+
+/**
+    Compute the value of a bicubic interpolation in image Mat at position (x,y)
+*/
+float interpolate_bicubic(Mat image, float y, float x)
+{
+    return BicubicInterpolation()(image, y, x);
+}
+
+/**
+    Tabulated separable kernels of the known interpolations.
+*/
+bool expandKernel(NearestInterpolation, int factor, ExpandKernel& kernel)
+{
+    kernel.taps = 1;
+    kernel.offsets.resize(factor);
+    kernel.weights.assign(factor, 1.f);
+    for (int p = 0; p < factor; p++)
+        kernel.offsets[p] = 2 * p >= factor;
+    return true;
+}
+
+bool expandKernel(BilinearInterpolation, int factor, ExpandKernel& kernel)
+{
+    kernel.taps = 2;
+    kernel.offsets.assign(factor, 0);
+    kernel.weights.resize(2 * factor);
+    for (int p = 0; p < factor; p++) {
+        float t = p / (float)factor;
+        kernel.weights[2 * p] = 1 - t;
+        kernel.weights[2 * p + 1] = t;
+    }
+    return true;
+}
+
+bool expandKernel(BicubicInterpolation, int factor, ExpandKernel& kernel)
+{
+    kernel.taps = 4;
+    kernel.offsets.assign(factor, -1);
+    kernel.weights.resize(4 * factor);
+    for (int p = 0; p < factor; p++)
+        cubicWeights(p / (float)factor, &kernel.weights[4 * p]);
+    return true;
+}
+
+/**
+    Border of the padded input rows of the horizontal pass, enough for the offsets and taps of all the kernels.
+*/
+static const int expandPadding = 2;
+
+/**
+    Horizontal pass: expands the input row src of cols pixels into the (cols-1)*factor pixels of dst.
+    The row is first copied into padded with its border replicated so that the taps need no clamping.
+    Each phase p is computed for all the bases, 4 bases at a time with SSE when available: the samples of
+    consecutive bases are contiguous, only the results are stored with a stride of factor.
+*/
+static void expandRow(const float* src, int cols, int factor, const ExpandKernel& kernel, float* padded, float* dst)
+{
+    for (int j = -expandPadding; j < cols + expandPadding; j++)
+        padded[j + expandPadding] = src[min(max(j, 0), cols - 1)];
+    int bases = cols - 1;
+    for (int p = 0; p < factor; p++) {
+        const float* samples = padded + expandPadding + kernel.offsets[p];
+        const float* weights = &kernel.weights[p * kernel.taps];
+        float* out = dst + p;
+        int base = 0;
+#if defined(__SSE2__)
+        for (; base + 4 <= bases; base += 4) {
+            __m128 v = _mm_mul_ps(_mm_set1_ps(weights[0]), _mm_loadu_ps(samples + base));
+            for (int k = 1; k < kernel.taps; k++)
+                v = _mm_add_ps(v, _mm_mul_ps(_mm_set1_ps(weights[k]), _mm_loadu_ps(samples + base + k)));
+            float values[4];
+            _mm_storeu_ps(values, v);
+            for (int q = 0; q < 4; q++)
+                out[(base + q) * factor] = values[q];
+        }
+#endif
+        for (; base < bases; base++) {
+            float v = weights[0] * samples[base];
+            for (int k = 1; k < kernel.taps; k++)
+                v += weights[k] * samples[base + k];
+            out[base * factor] = v;
+        }
+    }
+}
+
+/**
+    Vertical pass: dst is the sum of the n pixels rows[k] weighted by weights[k], with SSE when available.
+*/
+static void combineRows(const float* const* rows, const float* weights, int taps, float* dst, int n)
+{
+    int j = 0;
+#if defined(__SSE2__)
+    for (; j + 4 <= n; j += 4) {
+        __m128 v = _mm_mul_ps(_mm_set1_ps(weights[0]), _mm_loadu_ps(rows[0] + j));
+        for (int k = 1; k < taps; k++)
+            v = _mm_add_ps(v, _mm_mul_ps(_mm_set1_ps(weights[k]), _mm_loadu_ps(rows[k] + j)));
+        _mm_storeu_ps(dst + j, v);
+    }
+#endif
+    for (; j < n; j++) {
+        float v = weights[0] * rows[0][j];
+        for (int k = 1; k < taps; k++)
+            v += weights[k] * rows[k][j];
+        dst[j] = v;
+    }
+}
+
+/**
+    Separable expansion of the output rows [rowStart, rowEnd). The horizontally expanded input rows are kept in a
+    ring buffer indexed by row modulo the number of rows spanned by the kernel, so each one is computed once
+    per strip.
+*/
+void expandRows(const Mat& image, int factor, const ExpandKernel& kernel, Mat& res, int rowStart, int rowEnd)
+{
+    int minOffset = *min_element(kernel.offsets.begin(), kernel.offsets.end());
+    int maxOffset = *max_element(kernel.offsets.begin(), kernel.offsets.end());
+    int span = maxOffset - minOffset + kernel.taps;
+    vector<float> padded(image.cols + 2 * expandPadding);
+    vector<float> expanded(span * res.cols);
+    vector<int> rowInSlot(span, -1);
+    vector<const float*> rows(kernel.taps);
+    for (int i = rowStart; i < rowEnd; i++) {
+        int base = i / factor, p = i % factor;
+        for (int k = 0; k < kernel.taps; k++) {
+            int r = min(max(base + kernel.offsets[p] + k, 0), image.rows - 1);
+            int slot = r % span;
+            if (rowInSlot[slot] != r) {
+                expandRow(image.ptr<float>(r), image.cols, factor, kernel, padded.data(), &expanded[slot * res.cols]);
+                rowInSlot[slot] = r;
+            }
+            rows[k] = &expanded[slot * res.cols];
+        }
+        combineRows(rows.data(), &kernel.weights[p * kernel.taps], kernel.taps, res.ptr<float>(i), res.cols);
+    }
+}
+
+/**
+    Rotation by quarterTurns times 90 degrees clockwise, by transposition and flips.
+*/
+Mat rotateQuarterTurns(Mat image, int quarterTurns)
+{
+    Mat res;
+    switch (quarterTurns) {
+    case 1:
+        flip(transpose(image), res, 1);
+        break;
+    case 2:
+        flip(image, res, -1);
+        break;
+    case 3:
+        flip(transpose(image), res, 0);
+        break;
+    default:
+        res = image.clone();
+    }
+    return res;
 }
 
 /**
     Multiply the image resolution by a given factor using the given interpolation method.
     If the input size is (h,w) the output size shall be ((h-1)*factor, (w-1)*factor)
 */
-Mat expand(Mat image, int factor, float(* interpolationFunction)(cv::Mat image, float y, float x))
+Mat expand(Mat image, int factor, NearestInterpolation interpolation)
 {
-    assert(factor>0);
-    Mat res = Mat::zeros((image.rows-1)*factor,(image.cols-1)*factor,CV_32FC1);
-    /********************************************
-                YOUR CODE HERE
-    *********************************************/
-    
-    /********************************************
-                END OF YOUR CODE
-    *********************************************/
-    return res;
+    return expandWith(image, factor, interpolation);
+}
+
+Mat expand(Mat image, int factor, BilinearInterpolation interpolation)
+{
+    return expandWith(image, factor, interpolation);
+}
+
+Mat expand(Mat image, int factor, BicubicInterpolation interpolation)
+{
+    return expandWith(image, factor, interpolation);
 }
 
 /**
@@ -85,19 +464,47 @@ Mat expand(Mat image, int factor, float(* interpolationFunction)(cv::Mat image,
 
     Output pixels that map outside the input image are set to 0.
 */
-Mat rotate(Mat image, float angle, float(* interpolationFunction)(cv::Mat image, float y, float x))
+Mat rotate(Mat image, float angle, NearestInterpolation interpolation)
 {
-    Mat res = Mat::zeros(1,1,CV_32FC1);
-    /********************************************
-                YOUR CODE HERE
-    hint: to determine the size of the output, take
-    the bounding box of the rotated corners of the 
-    input image.
-    *********************************************/
-    
-    /********************************************
-                END OF YOUR CODE
-    *********************************************/
-    return res;
+    return rotateWith(image, angle, interpolation);
+}
 
-}
\ No newline at end of file
+Mat rotate(Mat image, float angle, BilinearInterpolation interpolation)
+{
+    return rotateWith(image, angle, interpolation);
+}
+
+Mat rotate(Mat image, float angle, BicubicInterpolation interpolation)
+{
+    return rotateWith(image, angle, interpolation);
+}
+
+/**
+    The known interpolation functions use their inlined functor, any other function is called through its pointer.
+*/
+Mat expand(Mat image, int factor, float(* interpolationFunction)(cv::Mat image, float y, float x))
+{
+    if (interpolationFunction == interpolate_nearest)
+        return expandWith(image, factor, NearestInterpolation());
+    if (interpolationFunction == interpolate_bilinear)
+        return expandWith(image, factor, BilinearInterpolation());
+    if (interpolationFunction == interpolate_bicubic)
+        return expandWith(image, factor, BicubicInterpolation());
+    FunctionInterpolation interpolation = {interpolationFunction};
+    return expandWith(image, factor, interpolation);
+}
+
+/**
+    The known interpolation functions use their inlined functor, any other function is called through its pointer.
+*/
+Mat rotate(Mat image, float angle, float(* interpolationFunction)(cv::Mat image, float y, float x))
+{
+    if (interpolationFunction == interpolate_nearest)
+        return rotateWith(image, angle, NearestInterpolation());
+    if (interpolationFunction == interpolate_bilinear)
+        return rotateWith(image, angle, BilinearInterpolation());
+    if (interpolationFunction == interpolate_bicubic)
+        return rotateWith(image, angle, BicubicInterpolation());
+    FunctionInterpolation interpolation = {interpolationFunction};
+    return rotateWith(image, angle, interpolation);
+}
@@ -5,10 +5,63 @@
 
 cv::Mat transpose(cv::Mat image);
 
+void transposeInPlace(cv::Mat image);
+
+/**
+    Interpolation functors, inlined in the sampling loops of interpolateRowWith, expandWith and rotateWith.
+    Any functor with the same call operator can be given to these templates; expand and rotate use a
+    tabulated separable kernel for these three.
+*/
+struct NearestInterpolation
+{
+    float operator()(const cv::Mat& image, float y, float x) const;
+};
+
+struct BilinearInterpolation
+{
+    float operator()(const cv::Mat& image, float y, float x) const;
+};
+
+struct BicubicInterpolation
+{
+    float operator()(const cv::Mat& image, float y, float x) const;
+};
+
+template<typename Interpolation>
+void interpolateRowWith(const cv::Mat& image, const float* y, const float* x, float* values, int n, Interpolation interpolation);
+
+template<typename Interpolation>
+cv::Mat expandWith(cv::Mat image, int factor, Interpolation interpolation);
+
+template<typename Interpolation>
+cv::Mat rotateWith(cv::Mat image, float angle, Interpolation interpolation);
+
+void interpolateRow(const cv::Mat& image, const float* y, const float* x, float* values, int n, NearestInterpolation interpolation);
+
+void interpolateRow(const cv::Mat& image, const float* y, const float* x, float* values, int n, BilinearInterpolation interpolation);
+
+void interpolateRow(const cv::Mat& image, const float* y, const float* x, float* values, int n, BicubicInterpolation interpolation);
+
+cv::Mat expand(cv::Mat image, int factor, NearestInterpolation interpolation);
+
+cv::Mat expand(cv::Mat image, int factor, BilinearInterpolation interpolation);
+
+cv::Mat expand(cv::Mat image, int factor, BicubicInterpolation interpolation);
+
+cv::Mat rotate(cv::Mat image, float angle, NearestInterpolation interpolation);
+
+cv::Mat rotate(cv::Mat image, float angle, BilinearInterpolation interpolation);
+
+cv::Mat rotate(cv::Mat image, float angle, BicubicInterpolation interpolation);
+
 float interpolate_nearest(cv::Mat image, float y, float x);
 
 float interpolate_bilinear(cv::Mat image, float y, float x);
 
+float interpolate_bicubic(cv::Mat image, float y, float x);
+
 cv::Mat expand(cv::Mat image, int factor, float(* interpolationFunction)(cv::Mat image, float y, float x));
 
 cv::Mat rotate(cv::Mat image, float angle, float(* interpolationFunction)(cv::Mat image, float y, float x));
+
+#include "tpGeometry.inl"
@@ -0,0 +1,245 @@
+// Template definitions of tpGeometry.h, included at its end.
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+/**
+    Clamps the coordinate v to [0, size-1].
+*/
+inline float clampCoordinate(float v, int size)
+{
+    return std::min(std::max(v, 0.f), (float)(size - 1));
+}
+
+/**
+    Value of the nearest neighbour of position (y,x) in the CV_32FC1 image, coordinates are clamped to the image.
+*/
+inline float NearestInterpolation::operator()(const cv::Mat& image, float y, float x) const
+{
+    int i = (int)(clampCoordinate(y, image.rows) + 0.5f);
+    int j = (int)(clampCoordinate(x, image.cols) + 0.5f);
+    return image.ptr<float>(std::min(i, image.rows - 1))[std::min(j, image.cols - 1)];
+}
+
+/**
+    Bilinear interpolation of the CV_32FC1 image at position (y,x) from its 4 neighbours,
+    coordinates are clamped to the image.
+*/
+inline float BilinearInterpolation::operator()(const cv::Mat& image, float y, float x) const
+{
+    y = clampCoordinate(y, image.rows);
+    x = clampCoordinate(x, image.cols);
+    int i0 = (int)y, j0 = (int)x;
+    int i1 = std::min(i0 + 1, image.rows - 1), j1 = std::min(j0 + 1, image.cols - 1);
+    float a = y - i0, b = x - j0;
+    const float* row0 = image.ptr<float>(i0);
+    const float* row1 = image.ptr<float>(i1);
+    return (1 - a) * ((1 - b) * row0[j0] + b * row0[j1]) + a * ((1 - b) * row1[j0] + b * row1[j1]);
+}
+
+/**
+    Weights of the 4 samples at offsets -1, 0, 1, 2 of the cubic convolution kernel (a = -0.5)
+    for a fractional position t in [0, 1).
+*/
+inline void cubicWeights(float t, float weights[4])
+{
+    const float a = -0.5f;
+    float s = 1 - t;
+    weights[0] = a * t * s * s;
+    weights[1] = (a + 2) * t * t * t - (a + 3) * t * t + 1;
+    weights[2] = (a + 2) * s * s * s - (a + 3) * s * s + 1;
+    weights[3] = a * s * t * t;
+}
+
+/**
+    Bicubic interpolation of the CV_32FC1 image at position (y,x) from its 16 neighbours,
+    the image border is replicated.
+*/
+inline float BicubicInterpolation::operator()(const cv::Mat& image, float y, float x) const
+{
+    y = clampCoordinate(y, image.rows);
+    x = clampCoordinate(x, image.cols);
+    int i0 = (int)y, j0 = (int)x;
+    float wy[4], wx[4];
+    cubicWeights(y - i0, wy);
+    cubicWeights(x - j0, wx);
+    int j[4];
+    for (int k = 0; k < 4; k++)
+        j[k] = std::min(std::max(j0 + k - 1, 0), image.cols - 1);
+    float v = 0;
+    for (int k = 0; k < 4; k++) {
+        const float* row = image.ptr<float>(std::min(std::max(i0 + k - 1, 0), image.rows - 1));
+        v += wy[k] * (wx[0] * row[j[0]] + wx[1] * row[j[1]] + wx[2] * row[j[2]] + wx[3] * row[j[3]]);
+    }
+    return v;
+}
+
+template<typename Interpolation>
+void interpolateRowWith(const cv::Mat& image, const float* y, const float* x, float* values, int n, Interpolation interpolation)
+{
+    for (int k = 0; k < n; k++)
+        values[k] = interpolation(image, y[k], x[k]);
+}
+
+/**
+    Separable kernel of an expansion by an integer factor: as the fractional offsets repeat with period factor,
+    output position base*factor+p is the sum of the taps input samples from base+offsets[p] weighted by
+    weights[p*taps ... p*taps+taps-1], in both directions.
+*/
+struct ExpandKernel
+{
+    int taps;
+    std::vector<int> offsets;
+    std::vector<float> weights;
+};
+
+/**
+    No separable kernel for an arbitrary interpolation, the known ones have their overload in tpGeometry.cpp.
+*/
+template<typename Interpolation>
+bool expandKernel(Interpolation interpolation, int factor, ExpandKernel& kernel)
+{
+    return false;
+}
+
+bool expandKernel(NearestInterpolation, int factor, ExpandKernel& kernel);
+
+bool expandKernel(BilinearInterpolation, int factor, ExpandKernel& kernel);
+
+bool expandKernel(BicubicInterpolation, int factor, ExpandKernel& kernel);
+
+void expandRows(const cv::Mat& image, int factor, const ExpandKernel& kernel, cv::Mat& res, int rowStart, int rowEnd);
+
+/**
+    Output pixel (i,j) samples the input at (i/factor, j/factor). When the interpolation has a separable kernel
+    the weights are tabulated once per phase and the expansion runs as a horizontal then a vertical 1-D pass,
+    both with SSE when available, by strips of output rows in parallel. Other interpolations sample a whole
+    row at a time.
+*/
+template<typename Interpolation>
+cv::Mat expandWith(cv::Mat image, int factor, Interpolation interpolation)
+{
+    CV_Assert(factor > 0 && image.type() == CV_32FC1);
+    cv::Mat res = cv::Mat::zeros((image.rows-1)*factor,(image.cols-1)*factor,CV_32FC1);
+    if (res.empty())
+        return res;
+
+    ExpandKernel kernel;
+    if (expandKernel(interpolation, factor, kernel)) {
+        int numberOfStrips = std::max(1, std::min(cv::getNumThreads(), res.rows));
+        cv::parallel_for_(cv::Range(0, numberOfStrips), [&](const cv::Range& range) {
+            for (int s = range.start; s < range.end; s++)
+                expandRows(image, factor, kernel, res, res.rows * s / numberOfStrips, res.rows * (s + 1) / numberOfStrips);
+        });
+        return res;
+    }
+
+    std::vector<float> y(res.cols), x(res.cols);
+    for (int j = 0; j < res.cols; j++)
+        x[j] = j / (float)factor;
+    for (int i = 0; i < res.rows; i++) {
+        std::fill(y.begin(), y.end(), i / (float)factor);
+        interpolateRowWith(image, y.data(), x.data(), res.ptr<float>(i), res.cols, interpolation);
+    }
+    return res;
+}
+
+/**
+    Side of the square output tiles of the rotation.
+*/
+const int rotateTile = 64;
+
+/**
+    Whether the interpolation gives back the pixel itself at integer positions, in which case rotations by
+    multiples of 90 degrees only move pixels. Unknown for an arbitrary interpolation.
+*/
+template<typename Interpolation>
+bool exactOnPixels(Interpolation interpolation)
+{
+    return false;
+}
+
+inline bool exactOnPixels(NearestInterpolation)
+{
+    return true;
+}
+
+inline bool exactOnPixels(BilinearInterpolation)
+{
+    return true;
+}
+
+inline bool exactOnPixels(BicubicInterpolation)
+{
+    return true;
+}
+
+cv::Mat rotateQuarterTurns(cv::Mat image, int quarterTurns);
+
+/**
+    The output is the bounding box of the rotated corners, output pixel (i,j) maps back to the input
+    by the inverse rotation around the centers of both images. Exact multiples of 90 degrees are done by
+    transposition and flips. Otherwise the output is processed by tiles in parallel: tiles whose inverse image
+    lies outside the input (with half a pixel of margin) are skipped, and in the others the input coordinates are
+    stepped incrementally along each row. As the input is convex, the pixels of a tile row that fall inside
+    it form a single span, sampled at once.
+*/
+template<typename Interpolation>
+cv::Mat rotateWith(cv::Mat image, float angle, Interpolation interpolation)
+{
+    CV_Assert(image.type() == CV_32FC1);
+    double turns = std::fmod((double)angle, 360.0) / 90;
+    if (turns == std::floor(turns) && exactOnPixels(interpolation))
+        return rotateQuarterTurns(image, ((int)turns + 4) % 4);
+
+    double theta = angle * CV_PI / 180, c = std::cos(theta), s = std::sin(theta);
+    double height = image.rows - 1, width = image.cols - 1;
+    int rows = (int)std::floor(std::fabs(c) * height + std::fabs(s) * width + 1e-4) + 1;
+    int cols = (int)std::floor(std::fabs(s) * height + std::fabs(c) * width + 1e-4) + 1;
+    cv::Mat res = cv::Mat::zeros(rows, cols, CV_32FC1);
+    double cy = height / 2, cx = width / 2, ocy = (rows - 1) / 2.0, ocx = (cols - 1) / 2.0;
+
+    int tileRows = (rows + rotateTile - 1) / rotateTile, tileCols = (cols + rotateTile - 1) / rotateTile;
+    cv::parallel_for_(cv::Range(0, tileRows * tileCols), [&](const cv::Range& range) {
+        std::vector<float> y(rotateTile), x(rotateTile);
+        for (int t = range.start; t < range.end; t++) {
+            int i0 = (t / tileCols) * rotateTile, i1 = std::min(i0 + rotateTile, rows);
+            int j0 = (t % tileCols) * rotateTile, j1 = std::min(j0 + rotateTile, cols);
+
+            // the output is the bounding box of the input footprint, so only the input axes can separate them
+            const double margin = 0.5;
+            double minY = height + margin, maxY = -margin, minX = width + margin, maxX = -margin;
+            for (int k = 0; k < 4; k++) {
+                double dy = (k & 1 ? i1 - 1 : i0) - ocy, dx = (k & 2 ? j1 - 1 : j0) - ocx;
+                double cornerY = cy + c * dy - s * dx, cornerX = cx + s * dy + c * dx;
+                minY = std::min(minY, cornerY);
+                maxY = std::max(maxY, cornerY);
+                minX = std::min(minX, cornerX);
+                maxX = std::max(maxX, cornerX);
+            }
+            if (maxY < -margin || minY > height + margin || maxX < -margin || minX > width + margin)
+                continue;
+
+            for (int i = i0; i < i1; i++) {
+                double dy = i - ocy, dx = j0 - ocx;
+                double rowY = cy + c * dy - s * dx, rowX = cx + s * dy + c * dx;
+                int first = j1, last = -1;
+                for (int j = j0; j < j1; j++) {
+                    float yj = (float)rowY, xj = (float)rowX;
+                    y[j - j0] = yj;
+                    x[j - j0] = xj;
+                    if (yj >= 0 && xj >= 0 && yj <= height && xj <= width) {
+                        first = std::min(first, j);
+                        last = j;
+                    }
+                    rowY -= s;
+                    rowX += c;
+                }
+                if (first <= last)
+                    interpolateRowWith(image, &y[first - j0], &x[first - j0], res.ptr<float>(i) + first, last - first + 1, interpolation);
+            }
+        }
+    });
+    return res;
+}
@@ -1,21 +1,176 @@
 #include "tpHistogram.h"
+#include "common.h"
 #include <cmath>
 #include <algorithm>
 #include <tuple>
+#include <cfloat>
 using namespace cv;
 using namespace std;
 
+const int Histogram::numberOfBins;
+
+/**
+    Empty histogram: all bins are 0.
+*/
+Histogram::Histogram(): numberOfPixels(0)
+{
+    std::fill(counts, counts + numberOfBins, 0);
+}
+
+/**
+    Counts the pixels of the rows [rowStart, rowEnd) of an unsigned char image into counts.
+    Four interleaved tables are used so that runs of equal pixels increment different
+    counters and do not wait on the previous store of the same bin.
+*/
+static void countRows(const Mat& image, int rowStart, int rowEnd, int* counts)
+{
+    int tables[4][Histogram::numberOfBins] = {{0}};
+    int cols = image.cols;
+    for (int i = rowStart; i < rowEnd; i++) {
+        const uchar* row = image.ptr<uchar>(i);
+        int j = 0;
+        for (; j + 4 <= cols; j += 4) {
+            tables[0][row[j]]++;
+            tables[1][row[j + 1]]++;
+            tables[2][row[j + 2]]++;
+            tables[3][row[j + 3]]++;
+        }
+        for (; j < cols; j++) {
+            tables[0][row[j]]++;
+        }
+    }
+    for (int v = 0; v < Histogram::numberOfBins; v++) {
+        counts[v] += tables[0][v] + tables[1][v] + tables[2][v] + tables[3][v];
+    }
+}
+
+/**
+    Computes the histogram of an unsigned char image.
+    The image is split in horizontal strips counted in parallel, each strip in its
+    own private bins; the partial histograms are merged at the end.
+*/
+Histogram::Histogram(Mat image): numberOfPixels((int)image.total())
+{
+    CV_Assert(image.type() == CV_8UC1);
+    std::fill(counts, counts + numberOfBins, 0);
+    if (image.empty())
+        return;
+
+    int numberOfStrips = std::max(1, std::min(getNumThreads(), image.rows));
+    vector<int> partial(numberOfStrips * numberOfBins, 0);
+    parallel_for_(Range(0, numberOfStrips), [&](const Range& range) {
+        for (int s = range.start; s < range.end; s++) {
+            int rowStart = image.rows * s / numberOfStrips;
+            int rowEnd = image.rows * (s + 1) / numberOfStrips;
+            countRows(image, rowStart, rowEnd, &partial[s * numberOfBins]);
+        }
+    });
+
+    for (int s = 0; s < numberOfStrips; s++) {
+        for (int v = 0; v < numberOfBins; v++) {
+            counts[v] += partial[s * numberOfBins + v];
+        }
+    }
+}
+
+/**
+    Cumulative histogram: res[v] is the number of pixels with a value lower or equal to v.
+*/
+vector<int> Histogram::cumulative() const
+{
+    vector<int> res(numberOfBins);
+    res[0] = counts[0];
+    for (int v = 1; v < numberOfBins; v++) {
+        res[v] = res[v - 1] + counts[v];
+    }
+    return res;
+}
+
+/**
+    Applies the per-pixel function op to every value of the float image and returns the result.
+    When the image is continuous the rows are flattened into a single span so that
+    the inner loop is a plain branch-free array traversal the compiler can vectorize.
+*/
+template<typename Op>
+static Mat applyPointOp(const Mat& image, Op op)
+{
+    Mat res(image.size(), image.type());
+    int rows = image.rows;
+    int cols = image.cols * image.channels();
+    if (image.isContinuous() && res.isContinuous()) {
+        cols *= rows;
+        rows = 1;
+    }
+    for (int i = 0; i < rows; i++) {
+        const float* src = image.ptr<float>(i);
+        float* dst = res.ptr<float>(i);
+        for (int j = 0; j < cols; j++) {
+            dst[j] = op(src[j]);
+        }
+    }
+    return res;
+}
+
+/**
+    Applies the float function op to an 8-bit image through a 256 entries lookup table.
+    The table is obtained by evaluating op on v/255 for every byte value v and scaling the
+    result back to [0;255], so the result is the same as converting the image to float,
+    applying op and writing it with imwriteHelper. cv::LUT performs the vectorized gather.
+*/
+template<typename Op>
+static Mat pointOpLut(Op op)
+{
+    // same scaling as imreadHelper (float multiplication by 1/255)
+    const float toUnit = (float)(1.0 / 255.0);
+    Mat lut(1, 256, CV_8UC1);
+    uchar* table = lut.ptr<uchar>(0);
+    for (int v = 0; v < 256; v++) {
+        table[v] = saturate_cast<uchar>(op(v * toUnit) * 255.0f);
+    }
+    return lut;
+}
+
+template<typename Op>
+static Mat applyPointOpLut(const Mat& image, Op op)
+{
+    Mat res;
+    cv::LUT(image, pointOpLut(op), res);
+    return res;
+}
+
+/**
+    Dispatches a point operator on the image depth:
+    unsigned char images go through a lookup table, float images through the direct loop.
+*/
+template<typename Op>
+static Mat pointOp(const Mat& image, Op op)
+{
+    if (image.depth() == CV_8U)
+        return applyPointOpLut(image, op);
+    CV_Assert(image.depth() == CV_32F);
+    return applyPointOp(image, op);
+}
+
 /**
     Inverse a grayscale image with float values.
     for all pixel p: res(p) = 1.0 - image(p)
+
+    Unsigned char images are also accepted, in which case res(p) = 255 - image(p).
 */
+static inline float inverseValue(float v)
+{
+    return 1.0f - v;
+}
+
 Mat inverse(Mat image)
 {
-    // clone original image
-    Mat res = image.clone();
-    cv::subtract(1.0f, image, res);
+    return pointOp(image, inverseValue);
+}
 
-    return res;
+static inline float thresholdValue(float v, float lowT, float highT)
+{
+    float r = (v <= lowT) ? 0.0f : v;
+    return (v > highT) ? 1.0f : r;
 }
 
 /**
@@ -24,16 +179,20 @@ Mat inverse(Mat image)
         | 0 if image(p) <= lowT
         | image(p) if lowT < image(p) <= hightT
         | 1 otherwise
+
+    Unsigned char images are also accepted, thresholds are still given in [0,1].
 */
 Mat threshold(Mat image, float lowT, float highT)
 {
-    Mat res = image.clone();
     assert(lowT <= highT);
+    return pointOp(image, [lowT, highT](float v) { return thresholdValue(v, lowT, highT); });
+}
 
-    cv::threshold(image, res, highT, 1.0f, cv::THRESH_BINARY_INV);
-    cv::threshold(res, res, lowT, 0.0f, cv::THRESH_BINARY);
-
-    return res;
+static inline float quantizeValue(float v, int lastLevel, float levelStep, float levels)
+{
+    int level = (int)(v * levels);
+    level = std::min(std::max(level, 0), lastLevel);
+    return level * levelStep;
 }
 
 /**
@@ -52,22 +211,17 @@ Mat threshold(Mat image, float lowT, float highT)
 
         and so on for other values of numberOfLevels.
 
+    Unsigned char images are also accepted, in which case the levels are scaled to [0;255].
 */
 Mat quantize(Mat image, int numberOfLevels)
 {
-    Mat res = image.clone();
     assert(numberOfLevels>0);
-    float step = 1.0f / numberOfLevels;
-    for(int i = 0; i < image.rows; i++) {
-        for(int j = 0; j < image.cols; j++) {
-            float value = image.at<float>(i,j);
-            int level = (int)(value / step);
-            if(level >= numberOfLevels) level = numberOfLevels - 1;
-            res.at<float>(i,j) = level * step;
-            if(level == numberOfLevels - 1) res.at<float>(i,j) = 1.0f;
-        }
-    }
-    return res;
+    int lastLevel = numberOfLevels - 1;
+    float levelStep = (lastLevel > 0) ? 1.0f / lastLevel : 0.0f;
+    float levels = (float)numberOfLevels;
+    return pointOp(image, [lastLevel, levelStep, levels](float v) {
+        return quantizeValue(v, lastLevel, levelStep, levels);
+    });
 }
 
 /**
@@ -76,7 +230,7 @@ Mat quantize(Mat image, int numberOfLevels)
 */
 Mat normalize(Mat image, float minValue, float maxValue)
 {
-    Mat res = image.clone();
+    Mat res;
     assert(minValue <= maxValue);
     double minVal, maxVal;
     cv::minMaxLoc(image, &minVal, &maxVal);
@@ -89,6 +243,195 @@ Mat normalize(Mat image, float minValue, float maxValue)
     return res;
 }
 
+PointPipeline& PointPipeline::inverse()
+{
+    Stage stage = {Inverse, 0, 0, 0, 0};
+    stages.push_back(stage);
+    return *this;
+}
+
+PointPipeline& PointPipeline::threshold(float lowT, float highT)
+{
+    assert(lowT <= highT);
+    Stage stage = {Threshold, lowT, highT, 0, 0};
+    stages.push_back(stage);
+    return *this;
+}
+
+PointPipeline& PointPipeline::quantize(int numberOfLevels)
+{
+    assert(numberOfLevels > 0);
+    int lastLevel = numberOfLevels - 1;
+    Stage stage = {Quantize, (lastLevel > 0) ? 1.0f / lastLevel : 0.0f, (float)numberOfLevels, 0, lastLevel};
+    stages.push_back(stage);
+    return *this;
+}
+
+/**
+    Linear mapping of [inputMin, inputMax] onto [minValue, maxValue]: unlike normalize,
+    the bounds of the input are given instead of being searched in the image.
+*/
+PointPipeline& PointPipeline::normalize(float inputMin, float inputMax, float minValue, float maxValue)
+{
+    assert(minValue <= maxValue);
+    float scale = 0.0f;
+    if (inputMax > inputMin)
+        scale = (maxValue - minValue) / (inputMax - inputMin);
+    Stage stage = {Affine, scale, minValue - inputMin * scale, 0, 0};
+    stages.push_back(stage);
+    return *this;
+}
+
+/**
+    Gamma correction: res(p) = image(p)^gamma, negative values are mapped to 0.
+*/
+PointPipeline& PointPipeline::gamma(float gamma)
+{
+    assert(gamma > 0);
+    Stage stage = {Gamma, gamma, 0, 0, 0};
+    stages.push_back(stage);
+    return *this;
+}
+
+/**
+    Value of a single pixel after all the stages.
+*/
+float PointPipeline::operator()(float value) const
+{
+    applySpan(&value, &value, 1);
+    return value;
+}
+
+/**
+    Applies the stages to length consecutive values, src and dst may be the same array.
+    The values are processed by blocks small enough to stay in the L1 cache: the first
+    stage reads the block from src, the next ones work in place on the block of dst.
+    Each stage is a plain loop over the block that the compiler can vectorize.
+*/
+void PointPipeline::applySpan(const float* src, float* dst, int length) const
+{
+    const int blockSize = 1024;
+    for (int start = 0; start < length; start += blockSize) {
+        int n = std::min(blockSize, length - start);
+        const float* in = src + start;
+        float* out = dst + start;
+        if (stages.empty() && in != out)
+            std::copy(in, in + n, out);
+        for (size_t s = 0; s < stages.size(); s++) {
+            const Stage& stage = stages[s];
+            switch (stage.type) {
+            case Inverse:
+                for (int j = 0; j < n; j++)
+                    out[j] = inverseValue(in[j]);
+                break;
+            case Threshold:
+                for (int j = 0; j < n; j++)
+                    out[j] = thresholdValue(in[j], stage.a, stage.b);
+                break;
+            case Quantize:
+                for (int j = 0; j < n; j++)
+                    out[j] = quantizeValue(in[j], stage.n, stage.a, stage.b);
+                break;
+            case Affine:
+                for (int j = 0; j < n; j++)
+                    out[j] = in[j] * stage.a + stage.b;
+                break;
+            case Gamma:
+                for (int j = 0; j < n; j++)
+                    out[j] = std::pow(std::max(in[j], 0.0f), stage.a);
+                break;
+            }
+            in = out;
+        }
+    }
+}
+
+/**
+    Applies the pipeline to a float image (or an unsigned char image, see applyInPlace)
+    and returns the result: the output image is the only allocation.
+*/
+Mat PointPipeline::apply(Mat image) const
+{
+    if (image.depth() == CV_8U)
+        return applyPointOpLut(image, *this);
+    CV_Assert(image.depth() == CV_32F);
+    Mat res(image.size(), image.type());
+    int rows = image.rows;
+    int cols = image.cols * image.channels();
+    if (image.isContinuous() && res.isContinuous()) {
+        cols *= rows;
+        rows = 1;
+    }
+    for (int i = 0; i < rows; i++) {
+        applySpan(image.ptr<float>(i), res.ptr<float>(i), cols);
+    }
+    return res;
+}
+
+/**
+    Applies the pipeline to the image, overwriting its values.
+    Float images are traversed once with all the stages fused. Unsigned char images
+    are mapped through a single lookup table obtained by running the stages on
+    every value v/255: the result is the same as applying the pipeline to the float
+    image and rounding once at the end, whatever the number of stages.
+*/
+void PointPipeline::applyInPlace(Mat image) const
+{
+    if (image.depth() == CV_8U) {
+        cv::LUT(image, pointOpLut(*this), image);
+        return;
+    }
+    CV_Assert(image.depth() == CV_32F);
+    int rows = image.rows;
+    int cols = image.cols * image.channels();
+    if (image.isContinuous()) {
+        cols *= rows;
+        rows = 1;
+    }
+    for (int i = 0; i < rows; i++) {
+        float* row = image.ptr<float>(i);
+        applySpan(row, row, cols);
+    }
+}
+
+/**
+    Normalize a grayscale binary PGM image (8 or 16 bits) that does not need to fit in memory.
+    Target range is [minValue, maxValue], where 1 stands for the maximum value of the PGM image.
+
+    The input is read by strips of stripRows rows twice: a first pass finds the minimum and
+    maximum values, the second one rescales each strip and appends it to the output image.
+    Memory usage is bounded by two strips, whatever the image height.
+*/
+void normalizeStreaming(string inputFilename, string outputFilename, int stripRows, float minValue, float maxValue)
+{
+    assert(minValue <= maxValue);
+    CV_Assert(stripRows > 0);
+    PgmStripReader reader(inputFilename);
+    Mat strip;
+
+    double minVal = DBL_MAX, maxVal = -DBL_MAX;
+    while (reader.read(strip, stripRows)) {
+        double stripMin, stripMax;
+        cv::minMaxLoc(strip, &stripMin, &stripMax);
+        minVal = std::min(minVal, stripMin);
+        maxVal = std::max(maxVal, stripMax);
+    }
+
+    double outputMax = (reader.depth() == CV_8U) ? 255 : 65535;
+    double scale = 0;
+    if (maxVal > minVal)
+        scale = outputMax * (maxValue - minValue) / (maxVal - minVal);
+    double shift = outputMax * minValue - minVal * scale;
+
+    reader.rewind();
+    PgmStripWriter writer(outputFilename, reader.rows(), reader.cols(), reader.depth());
+    Mat res;
+    while (reader.read(strip, stripRows)) {
+        strip.convertTo(res, reader.depth(), scale, shift);
+        writer.write(res);
+    }
+}
+
 /**
     Equalize image histogram with unsigned char values ([0;255])
 
@@ -97,30 +440,481 @@ Mat normalize(Mat image, float minValue, float maxValue)
 */
 Mat equalize(Mat image)
 {
-    Mat res = image.clone();
+    return equalize(image, Histogram(image));
+}
+
+/**
+    Equalization lookup table of the cumulative histogram of total values: 255 * cumulative[v] / total,
+    computed in float and rounded toward the nearest integer. Shared by equalize and RunningEqualizer
+    so that both round the same way.
+*/
+static Mat equalizationLut(const vector<double>& cumulative, double total)
+{
+    Mat lut(1, Histogram::numberOfBins, CV_8UC1);
+    float scale = 255.0f / (float)total;
+    for (int v = 0; v < Histogram::numberOfBins; v++) {
+        float newValue = scale * (float)cumulative[v];
+        lut.at<uchar>(v) = cv::saturate_cast<uchar>(round(newValue));
+    }
+    return lut;
+}
+
+/**
+    Equalize image histogram with unsigned char values ([0;255]) using
+    the already computed histogram of the image.
+*/
+Mat equalize(Mat image, const Histogram& histogram)
+{
+    vector<int> cumulative = histogram.cumulative();
+    Mat lut = equalizationLut(vector<double>(cumulative.begin(), cumulative.end()), histogram.total());
+
+    Mat res;
+    cv::LUT(image, lut, res);
+    return res;
+}
+
+/**
+    Equalizer with an exponentially decayed histogram: at each frame the running counts
+    are multiplied by decay before adding the counts of the new frame.
+    The lookup table is rebuilt when the cumulative distribution moved by more than
+    tolerance (maximum absolute difference) since it was last built.
+*/
+RunningEqualizer RunningEqualizer::decayed(float decay, float tolerance)
+{
+    CV_Assert(decay >= 0 && decay < 1);
+    return RunningEqualizer(decay, 0, tolerance);
+}
+
+/**
+    Equalizer with the histogram of the numberOfFrames last frames.
+*/
+RunningEqualizer RunningEqualizer::windowed(int numberOfFrames, float tolerance)
+{
+    CV_Assert(numberOfFrames > 0);
+    return RunningEqualizer(1, numberOfFrames, tolerance);
+}
+
+RunningEqualizer::RunningEqualizer(float decay, int numberOfFrames, float tolerance):
+    decay(decay), numberOfFrames(numberOfFrames), tolerance(tolerance), rebuilds(0)
+{
+    CV_Assert(tolerance >= 0);
+    reset();
+}
+
+/**
+    Forgets all the previous frames.
+*/
+void RunningEqualizer::reset()
+{
+    counts.assign(Histogram::numberOfBins, 0.0);
+    total = 0;
+    window.clear();
+    lutCdf.clear();
+    lut.release();
+}
 
-    int histogram[256] = {0};
-    for(int i = 0; i < image.rows; i++) {
-        for(int j = 0; j < image.cols; j++) {
-            histogram[image.at<uchar>(i,j)]++;
+/**
+    Adds the counts of a new frame to the running histogram.
+*/
+void RunningEqualizer::update(const Histogram& histogram)
+{
+    if (numberOfFrames > 0) {
+        window.push_back(histogram);
+        if ((int)window.size() > numberOfFrames) {
+            const Histogram& oldest = window.front();
+            for (int v = 0; v < Histogram::numberOfBins; v++)
+                counts[v] -= oldest[v];
+            total -= oldest.total();
+            window.pop_front();
         }
+    } else {
+        for (int v = 0; v < Histogram::numberOfBins; v++)
+            counts[v] *= decay;
+        total *= decay;
     }
-    
-    int cumulative[256] = {0};
-    cumulative[0] = histogram[0];
-    for(int i = 1; i < 256; i++) {
-        cumulative[i] = cumulative[i-1] + histogram[i];
+    for (int v = 0; v < Histogram::numberOfBins; v++)
+        counts[v] += histogram[v];
+    total += histogram.total();
+}
+
+/**
+    Equalization lookup table of the running cumulative histogram, computed as in equalize
+    (a one frame window gives the same result), cdf being the matching cumulative distribution.
+*/
+void RunningEqualizer::rebuildLut(const vector<double>& cumulative, const vector<double>& cdf)
+{
+    lut = equalizationLut(cumulative, total);
+    lutCdf = cdf;
+    rebuilds++;
+}
+
+/**
+    Adds the frame to the running histogram and returns the equalized frame.
+*/
+Mat RunningEqualizer::apply(Mat frame)
+{
+    return apply(frame, Histogram(frame));
+}
+
+/**
+    Same as apply(frame) using the already computed histogram of the frame.
+*/
+Mat RunningEqualizer::apply(Mat frame, const Histogram& histogram)
+{
+    update(histogram);
+
+    if (total > 0) {
+        vector<double> cumulative(Histogram::numberOfBins), cdf(Histogram::numberOfBins);
+        double sum = 0, drift = 0;
+        for (int v = 0; v < Histogram::numberOfBins; v++) {
+            sum += counts[v];
+            cumulative[v] = sum;
+            cdf[v] = sum / total;
+            if (!lutCdf.empty())
+                drift = std::max(drift, std::abs(cdf[v] - lutCdf[v]));
+        }
+        if (lutCdf.empty() || drift > tolerance)
+            rebuildLut(cumulative, cdf);
     }
-    
-    float scale = 255.0f / (image.rows * image.cols);
-    for(int i = 0; i < image.rows; i++) {
-        for(int j = 0; j < image.cols; j++) {
-            int pixel = image.at<uchar>(i,j);
-            float newValue = scale * cumulative[pixel];
-            res.at<uchar>(i,j) = cv::saturate_cast<uchar>(round(newValue));
+
+    if (lut.empty())
+        return frame.clone();
+    Mat res;
+    cv::LUT(frame, lut, res);
+    return res;
+}
+
+/**
+    Prepares the matching of unsigned char images ([0;255]) to the histogram of the reference image.
+*/
+HistogramMatcher::HistogramMatcher(Mat reference): HistogramMatcher(Histogram(reference))
+{
+}
+
+HistogramMatcher::HistogramMatcher(const Histogram& reference):
+    referenceCumulative(reference.cumulative()), referenceTotal(reference.total())
+{
+    CV_Assert(referenceTotal > 0);
+}
+
+/**
+    Transforms the unsigned char image so that its histogram matches the reference one.
+*/
+Mat HistogramMatcher::apply(Mat image) const
+{
+    return apply(image, Histogram(image));
+}
+
+/**
+    Histogram matching using the already computed histogram of the image.
+    Each value v is mapped to the smallest reference value r such that
+    cdfReference(r) >= cdfImage(v). Both cumulative histograms are increasing so
+    the mapping is found in a single simultaneous scan of the two tables.
+    The cumulative frequencies are compared as cross products of integer counts
+    to avoid rounding errors.
+*/
+Mat HistogramMatcher::apply(Mat image, const Histogram& histogram) const
+{
+    vector<int> cumulative = histogram.cumulative();
+    int64 total = histogram.total();
+
+    Mat lut(1, Histogram::numberOfBins, CV_8UC1);
+    int r = 0;
+    for (int v = 0; v < Histogram::numberOfBins; v++) {
+        int64 target = (int64)cumulative[v] * referenceTotal;
+        while (r < Histogram::numberOfBins - 1 && (int64)referenceCumulative[r] * total < target)
+            r++;
+        lut.at<uchar>(v) = (uchar)r;
+    }
+
+    Mat res;
+    cv::LUT(image, lut, res);
+    return res;
+}
+
+/**
+    Transforms the unsigned char image ([0;255]) so that its histogram matches the
+    histogram of the reference image. Use a HistogramMatcher to match several images
+    to the same reference.
+*/
+Mat matchHistogram(Mat image, Mat reference)
+{
+    return HistogramMatcher(reference).apply(image);
+}
+
+/**
+    Cumulative histogram of an image of 16 bits keys (CV_16U).
+
+    The histogram is built on two levels: a first pass counts the 256 possible high bytes,
+    then 256 bins tables for the low bytes are only allocated for the high bytes that
+    actually occur. Images that use a narrow part of the 16 bits range therefore only touch
+    a few KB of counters instead of 65536 bins. Both passes are done on parallel strips
+    with private counters merged at the end.
+*/
+static vector<int> cumulativeHistogram16(const Mat& keys)
+{
+    const int bins = 256;
+    int numberOfStrips = std::max(1, std::min(getNumThreads(), keys.rows));
+
+    // first level: high bytes
+    vector<int> coarsePartial(numberOfStrips * bins, 0);
+    parallel_for_(Range(0, numberOfStrips), [&](const Range& range) {
+        for (int s = range.start; s < range.end; s++) {
+            int* coarse = &coarsePartial[s * bins];
+            for (int i = keys.rows * s / numberOfStrips; i < keys.rows * (s + 1) / numberOfStrips; i++) {
+                const ushort* row = keys.ptr<ushort>(i);
+                for (int j = 0; j < keys.cols; j++) {
+                    coarse[row[j] >> 8]++;
+                }
+            }
+        }
+    });
+
+    vector<int> bucket(bins, -1);
+    int numberOfBuckets = 0;
+    for (int h = 0; h < bins; h++) {
+        for (int s = 0; s < numberOfStrips; s++) {
+            if (coarsePartial[s * bins + h] != 0) {
+                bucket[h] = numberOfBuckets++;
+                break;
+            }
+        }
+    }
+
+    // second level: low bytes, only for the occupied high bytes
+    int fineSize = numberOfBuckets * bins;
+    vector<int> finePartial(numberOfStrips * fineSize, 0);
+    parallel_for_(Range(0, numberOfStrips), [&](const Range& range) {
+        const int* bucketOf = &bucket[0];
+        for (int s = range.start; s < range.end; s++) {
+            int* fine = &finePartial[s * fineSize];
+            for (int i = keys.rows * s / numberOfStrips; i < keys.rows * (s + 1) / numberOfStrips; i++) {
+                const ushort* row = keys.ptr<ushort>(i);
+                for (int j = 0; j < keys.cols; j++) {
+                    fine[bucketOf[row[j] >> 8] * bins + (row[j] & 255)]++;
+                }
+            }
+        }
+    });
+
+    vector<int> cumulative(bins * bins);
+    int running = 0;
+    for (int h = 0; h < bins; h++) {
+        for (int l = 0; l < bins; l++) {
+            if (bucket[h] >= 0) {
+                for (int s = 0; s < numberOfStrips; s++) {
+                    running += finePartial[s * fineSize + bucket[h] * bins + l];
+                }
+            }
+            cumulative[h * bins + l] = running;
+        }
+    }
+    return cumulative;
+}
+
+/**
+    Maps every key of the CV_16U image keys through the table lut (65536 entries of type T).
+*/
+template<typename T>
+static Mat applyLut16(const Mat& keys, const Mat& lut)
+{
+    Mat res(keys.size(), lut.type());
+    parallel_for_(Range(0, keys.rows), [&](const Range& range) {
+        const T* table = lut.ptr<T>(0);
+        for (int i = range.start; i < range.end; i++) {
+            const ushort* src = keys.ptr<ushort>(i);
+            T* dst = res.ptr<T>(i);
+            for (int j = 0; j < keys.cols; j++) {
+                dst[j] = table[src[j]];
+            }
+        }
+    });
+    return res;
+}
+
+/**
+    16 bits key (CV_16U) of each pixel of a grayscale image with 8 bits, 16 bits, 32 bits integer or float values:
+    key = value * scale + shift.
+
+    Integer images whose value range fits in 16 bits keep their exact values (scale is 1),
+    the others are quantized on 65536 levels between their minimum and maximum.
+*/
+static Mat histogramKeys(const Mat& image, double& scale, double& shift)
+{
+    int depth = image.depth();
+    CV_Assert(image.channels() == 1);
+    CV_Assert(depth == CV_8U || depth == CV_16U || depth == CV_32S || depth == CV_32F);
+
+    scale = 1;
+    shift = 0;
+    Mat keys;
+    if (depth == CV_16U) {
+        keys = image;
+    } else if (depth == CV_8U) {
+        image.convertTo(keys, CV_16U);
+    } else {
+        double minValue, maxValue;
+        cv::minMaxLoc(image, &minValue, &maxValue);
+        if ((depth == CV_32F || maxValue - minValue > 65535) && maxValue > minValue)
+            scale = 65535.0 / (maxValue - minValue);
+        shift = -minValue * scale;
+        image.convertTo(keys, CV_16U, scale, shift);
+    }
+    return keys;
+}
+
+/**
+    Equalize the histogram of a grayscale image with 8 bits, 16 bits, 32 bits integer or float values.
+
+    Integer images whose value range fits in 16 bits are equalized exactly, the others
+    (and float images) are first quantized on 65536 levels between their minimum and maximum.
+
+    outputDepth is the depth of the result: CV_8U ([0;255]), CV_16U ([0;65535]) or CV_32F ([0;1]).
+    By default the input depth is kept (CV_16U for 32 bits integer images).
+*/
+Mat equalizeHighDepth(Mat image, int outputDepth)
+{
+    int depth = image.depth();
+    if (outputDepth < 0)
+        outputDepth = (depth == CV_32S) ? CV_16U : depth;
+    CV_Assert(outputDepth == CV_8U || outputDepth == CV_16U || outputDepth == CV_32F);
+
+    double scale, shift;
+    Mat keys = histogramKeys(image, scale, shift);
+    vector<int> cumulative = cumulativeHistogram16(keys);
+
+    double total = (double)image.total();
+    Mat lut(1, 65536, CV_MAKETYPE(outputDepth, 1));
+    for (int k = 0; k < 65536; k++) {
+        double v = cumulative[k] / total;
+        if (outputDepth == CV_8U)
+            lut.at<uchar>(k) = saturate_cast<uchar>(v * 255);
+        else if (outputDepth == CV_16U)
+            lut.at<ushort>(k) = saturate_cast<ushort>(v * 65535);
+        else
+            lut.at<float>(k) = (float)v;
+    }
+
+    if (outputDepth == CV_8U)
+        return applyLut16<uchar>(keys, lut);
+    if (outputDepth == CV_16U)
+        return applyLut16<ushort>(keys, lut);
+    return applyLut16<float>(keys, lut);
+}
+
+/**
+    Limits every bin of the histogram to limit and spreads the clipped
+    pixels uniformly over all the bins (contrast limitation of CLAHE).
+*/
+static void clipHistogram(int* counts, int limit)
+{
+    int excess = 0;
+    for (int v = 0; v < Histogram::numberOfBins; v++) {
+        if (counts[v] > limit) {
+            excess += counts[v] - limit;
+            counts[v] = limit;
+        }
+    }
+
+    int batch = excess / Histogram::numberOfBins;
+    int residual = excess - batch * Histogram::numberOfBins;
+    for (int v = 0; v < Histogram::numberOfBins; v++) {
+        counts[v] += batch;
+    }
+    if (residual > 0) {
+        int step = std::max(Histogram::numberOfBins / residual, 1);
+        for (int v = 0; v < Histogram::numberOfBins && residual > 0; v += step, residual--) {
+            counts[v]++;
+        }
+    }
+}
+
+/**
+    Contrast limited adaptive histogram equalization (CLAHE) of an image with unsigned char values ([0;255]).
+
+    The image is divided in gridSize x gridSize tiles. The histogram of each tile is clipped at
+    clipLimit times the mean bin count, the clipped pixels are redistributed over all the bins,
+    and the tile is given the equalization lookup table of this histogram.
+    Each output pixel is then the bilinear interpolation of the lookup tables of the 4 tiles
+    whose centers surround it. A clipLimit lower or equal to 0 disables the contrast limitation.
+*/
+Mat equalizeAdaptive(Mat image, int gridSize, float clipLimit)
+{
+    CV_Assert(image.type() == CV_8UC1);
+    CV_Assert(gridSize > 0 && gridSize <= image.rows && gridSize <= image.cols);
+
+    const int bins = Histogram::numberOfBins;
+    int numberOfTiles = gridSize * gridSize;
+    float tileWidth = (float)image.cols / gridSize;
+    float tileHeight = (float)image.rows / gridSize;
+
+    // one lookup table per tile, tiles are processed in parallel
+    vector<uchar> luts(numberOfTiles * bins);
+    parallel_for_(Range(0, numberOfTiles), [&](const Range& range) {
+        for (int t = range.start; t < range.end; t++) {
+            int tx = t % gridSize;
+            int ty = t / gridSize;
+            int x0 = image.cols * tx / gridSize, x1 = image.cols * (tx + 1) / gridSize;
+            int y0 = image.rows * ty / gridSize, y1 = image.rows * (ty + 1) / gridSize;
+
+            Histogram histogram(image(Rect(x0, y0, x1 - x0, y1 - y0)));
+            int counts[Histogram::numberOfBins];
+            for (int v = 0; v < bins; v++) {
+                counts[v] = histogram[v];
+            }
+            if (clipLimit > 0) {
+                int limit = std::max(1, (int)(clipLimit * histogram.total() / bins));
+                clipHistogram(counts, limit);
+            }
+
+            uchar* lut = &luts[t * bins];
+            float scale = 255.0f / histogram.total();
+            int cumulative = 0;
+            for (int v = 0; v < bins; v++) {
+                cumulative += counts[v];
+                lut[v] = saturate_cast<uchar>(scale * cumulative);
+            }
         }
+    });
+
+    // horizontal neighbour tiles and weights do not depend on the row,
+    // weights are stored in fixed point with 8 fractional bits
+    const int one = 256;
+    vector<int> leftTile(image.cols), rightTile(image.cols), rightWeight(image.cols);
+    for (int x = 0; x < image.cols; x++) {
+        float fx = (x + 0.5f) / tileWidth - 0.5f;
+        int tx = cvFloor(fx);
+        rightWeight[x] = cvRound((fx - tx) * one);
+        leftTile[x] = std::max(tx, 0) * bins;
+        rightTile[x] = std::min(tx + 1, gridSize - 1) * bins;
     }
 
+    Mat res(image.size(), CV_8UC1);
+    parallel_for_(Range(0, image.rows), [&](const Range& range) {
+        for (int y = range.start; y < range.end; y++) {
+            float fy = (y + 0.5f) / tileHeight - 0.5f;
+            int ty = cvFloor(fy);
+            int bottomWeight = cvRound((fy - ty) * one);
+            int topWeight = one - bottomWeight;
+            const uchar* top = &luts[std::max(ty, 0) * gridSize * bins];
+            const uchar* bottom = &luts[std::min(ty + 1, gridSize - 1) * gridSize * bins];
+
+            const int* left = &leftTile[0];
+            const int* right = &rightTile[0];
+            const int* weight = &rightWeight[0];
+            const uchar* src = image.ptr<uchar>(y);
+            uchar* dst = res.ptr<uchar>(y);
+            for (int x = 0; x < image.cols; x++) {
+                int v = src[x];
+                int l = left[x] + v, r = right[x] + v;
+                int wr = weight[x], wl = one - wr;
+                int upper = top[l] * wl + top[r] * wr;
+                int lower = bottom[l] * wl + bottom[r] * wr;
+                dst[x] = (uchar)((upper * topWeight + lower * bottomWeight + one * one / 2) >> 16);
+            }
+        }
+    });
+
     return res;
 }
 
@@ -130,23 +924,27 @@ Mat equalize(Mat image)
 */
 Mat thresholdOtsu(Mat image)
 {
-    Mat res = image.clone();
-
     if (image.channels() > 1) {
         cerr << "Erreur: L'image doit être en niveaux de gris pour appliquer Otsu." << endl;
-        return res;
+        return image.clone();
     }
 
-    vector<float> histogram(256, 0);
-    Mat hist;
-    int histSize = 256;
-    float range[] = {0, 256};
-    const float* histRange = {range};
-    calcHist(&image, 1, 0, Mat(), hist, 1, &histSize, &histRange);
+    return thresholdOtsu(image, Histogram(image));
+}
 
-    float totalPixels = image.total();
+/**
+    Compute a binarization of the input image using an automatic Otsu threshold
+    computed on the already known histogram of the image.
+    Input image is of type unsigned char ([0;255])
+*/
+Mat thresholdOtsu(Mat image, const Histogram& hist)
+{
+    Mat res;
+
+    vector<float> histogram(256, 0);
+    float totalPixels = hist.total();
     for (int i = 0; i < 256; i++) {
-        histogram[i] = hist.at<float>(i) / totalPixels;
+        histogram[i] = hist[i] / totalPixels;
     }
 
     float maxVariance = 0;
@@ -169,7 +967,8 @@ Mat thresholdOtsu(Mat image)
         float meanBackground = sumBackground / weightBackground;
         float meanForeground = (sumTotal - sumBackground) / weightForeground;
 
-        float variance = weightBackground * weightForeground * pow(meanBackground - meanForeground, 2);
+        double difference = meanBackground - meanForeground;
+        float variance = weightBackground * weightForeground * (difference * difference);
 
         if (variance > maxVariance) {
             maxVariance = variance;
@@ -181,3 +980,253 @@ Mat thresholdOtsu(Mat image)
 
     return res;
 }
+
+/**
+    Compute the numberOfClasses-1 thresholds maximizing the between-class variance
+    of the histogram (multi-level Otsu). A pixel of value v belongs to the class k
+    if thresholds[k-1] < v <= thresholds[k].
+
+    With the cumulative zeroth and first order moments P and S, the contribution
+    of the class made of the bins [a,b] to the between-class variance is
+    (S(b)-S(a-1))^2 / (P(b)-P(a-1)), computed in O(1).
+    The optimal partition is found by dynamic programming over the classes.
+    Moving a class boundary over empty bins does not change the variance, so only
+    the non empty bins are candidate class starts.
+*/
+vector<int> otsuThresholds(const Histogram& histogram, int numberOfClasses)
+{
+    CV_Assert(numberOfClasses >= 2);
+
+    // non empty bins and their cumulative moments
+    vector<int> values;
+    vector<double> zeroth(1, 0.0), first(1, 0.0);
+    for (int v = 0; v < Histogram::numberOfBins; v++) {
+        if (histogram[v] != 0) {
+            values.push_back(v);
+            zeroth.push_back(zeroth.back() + histogram[v]);
+            first.push_back(first.back() + (double)v * histogram[v]);
+        }
+    }
+    int n = (int)values.size();
+
+    // not enough distinct values: every value gets its own class
+    if (n <= numberOfClasses) {
+        vector<int> thresholds;
+        for (int i = 0; i + 1 < n; i++)
+            thresholds.push_back(values[i]);
+        while ((int)thresholds.size() < numberOfClasses - 1)
+            thresholds.push_back(Histogram::numberOfBins - 1);
+        return thresholds;
+    }
+
+    // best[k][b]: best variance for k+1 classes covering the non empty bins [0,b]
+    // start[k][b]: first bin of the last class in this partition
+    vector<vector<double> > best(numberOfClasses, vector<double>(n, 0.0));
+    vector<vector<int> > start(numberOfClasses, vector<int>(n, 0));
+    for (int b = 0; b < n; b++) {
+        best[0][b] = first[b + 1] * first[b + 1] / zeroth[b + 1];
+    }
+    for (int k = 1; k < numberOfClasses; k++) {
+        // the last class needs room for the k classes before it
+        for (int b = k; b < n; b++) {
+            double bestVariance = -1;
+            int bestStart = k;
+            for (int a = k; a <= b; a++) {
+                double weight = zeroth[b + 1] - zeroth[a];
+                double moment = first[b + 1] - first[a];
+                double variance = best[k - 1][a - 1] + moment * moment / weight;
+                if (variance > bestVariance) {
+                    bestVariance = variance;
+                    bestStart = a;
+                }
+            }
+            best[k][b] = bestVariance;
+            start[k][b] = bestStart;
+        }
+    }
+
+    vector<int> thresholds(numberOfClasses - 1);
+    int b = n - 1;
+    for (int k = numberOfClasses - 1; k > 0; k--) {
+        int a = start[k][b];
+        thresholds[k - 1] = values[a - 1];
+        b = a - 1;
+    }
+    return thresholds;
+}
+
+/**
+    Segments the unsigned char image ([0;255]) in numberOfClasses classes using multi-level Otsu thresholds.
+    The pixels of the class k (from 0 to numberOfClasses-1) get the value k * 255 / (numberOfClasses-1).
+*/
+Mat thresholdOtsuMulti(Mat image, int numberOfClasses)
+{
+    return thresholdOtsuMulti(image, Histogram(image), numberOfClasses);
+}
+
+/**
+    Multi-level Otsu segmentation using the already computed histogram of the image.
+*/
+Mat thresholdOtsuMulti(Mat image, const Histogram& histogram, int numberOfClasses)
+{
+    vector<int> thresholds = otsuThresholds(histogram, numberOfClasses);
+
+    Mat lut(1, Histogram::numberOfBins, CV_8UC1);
+    int k = 0;
+    for (int v = 0; v < Histogram::numberOfBins; v++) {
+        while (k < numberOfClasses - 1 && v > thresholds[k])
+            k++;
+        lut.at<uchar>(v) = saturate_cast<uchar>(k * 255.0 / (numberOfClasses - 1));
+    }
+
+    Mat res;
+    cv::LUT(image, lut, res);
+    return res;
+}
+
+/**
+    Binary image (0 or 255) of the pixels of a grayscale image (8 bits, 16 bits, 32 bits integer
+    or float values) that are greater than the threshold chosen by selectThreshold.
+
+    The threshold is computed on the histogram of the image instead of the pixels:
+    selectThreshold receives the increasing values of the non empty bins and their number
+    of pixels. Unsigned char images use a Histogram, the other ones the 16 bits keys histogram
+    used by equalizeHighDepth, which is exact for integer images whose value range fits in 16 bits.
+*/
+template<typename Selector>
+static Mat thresholdFromHistogram(const Mat& image, Selector selectThreshold)
+{
+    CV_Assert(image.channels() == 1);
+    vector<double> values, counts;
+
+    if (image.depth() == CV_8U) {
+        Histogram histogram(image);
+        for (int v = 0; v < Histogram::numberOfBins; v++) {
+            if (histogram[v] != 0) {
+                values.push_back(v);
+                counts.push_back(histogram[v]);
+            }
+        }
+        double t = selectThreshold(values, counts);
+
+        Mat lut(1, Histogram::numberOfBins, CV_8UC1);
+        for (int v = 0; v < Histogram::numberOfBins; v++)
+            lut.at<uchar>(v) = (v > t) ? 255 : 0;
+        Mat res;
+        cv::LUT(image, lut, res);
+        return res;
+    }
+
+    double scale, shift;
+    Mat keys = histogramKeys(image, scale, shift);
+    vector<int> cumulative = cumulativeHistogram16(keys);
+    for (int k = 0; k < 65536; k++) {
+        int count = cumulative[k] - ((k > 0) ? cumulative[k - 1] : 0);
+        if (count != 0) {
+            values.push_back((k - shift) / scale);
+            counts.push_back(count);
+        }
+    }
+    double t = selectThreshold(values, counts);
+
+    Mat lut(1, 65536, CV_8UC1);
+    for (int k = 0; k < 65536; k++)
+        lut.at<uchar>(k) = ((k - shift) / scale > t) ? 255 : 0;
+    return applyLut16<uchar>(keys, lut);
+}
+
+/**
+    Iterative 2-means clustering of the histogram (values, counts).
+    The threshold is the middle of the means of the two classes (values lower or equal to the
+    threshold, and greater values), it is updated until the classes do not change anymore.
+    With the cumulative sums of the counts and of the moments, each iteration is a binary
+    search followed by two means computed in constant time.
+*/
+static double kMeanThreshold(const vector<double>& values, const vector<double>& counts)
+{
+    size_t n = values.size();
+    vector<double> weight(n + 1, 0.0), moment(n + 1, 0.0);
+    for (size_t i = 0; i < n; i++) {
+        weight[i + 1] = weight[i] + counts[i];
+        moment[i + 1] = moment[i] + counts[i] * values[i];
+    }
+
+    double t = moment[n] / weight[n];
+    size_t split = n + 1;
+    for (int iteration = 0; iteration < 1000; iteration++) {
+        size_t i = std::upper_bound(values.begin(), values.end(), t) - values.begin();
+        if (i == split || i == 0 || i == n)
+            break;
+        split = i;
+        double meanLow = moment[i] / weight[i];
+        double meanHigh = (moment[n] - moment[i]) / (weight[n] - weight[i]);
+        t = (meanLow + meanHigh) / 2;
+    }
+    return t;
+}
+
+/**
+    Thresholds a grayscale image (8 bits, 16 bits, 32 bits integer or float values) with the
+    k-means algorithm on 2 classes. Pixels of the class with the highest mean are set to 255,
+    the other ones to 0.
+*/
+Mat thresholdKMean(Mat image)
+{
+    return thresholdFromHistogram(image, kMeanThreshold);
+}
+
+/**
+    Sigma clipping on the histogram (values, counts): the mean m and standard deviation s
+    are computed on the values in [m - kappa*s, m + kappa*s] with the m and s of the previous
+    iteration (all values at the first one), until this interval does not change anymore.
+    The result is m + kappa*s.
+    The moments are accumulated relative to the global mean to limit rounding errors.
+*/
+static double sigmaClippingThreshold(const vector<double>& values, const vector<double>& counts, float kappa)
+{
+    size_t n = values.size();
+    double center = 0, total = 0;
+    for (size_t i = 0; i < n; i++) {
+        center += counts[i] * values[i];
+        total += counts[i];
+    }
+    center /= total;
+
+    vector<double> weight(n + 1, 0.0), moment(n + 1, 0.0), moment2(n + 1, 0.0);
+    for (size_t i = 0; i < n; i++) {
+        double d = values[i] - center;
+        weight[i + 1] = weight[i] + counts[i];
+        moment[i + 1] = moment[i] + counts[i] * d;
+        moment2[i + 1] = moment2[i] + counts[i] * d * d;
+    }
+
+    size_t low = 0, high = n;
+    double mean = center, sigma = 0;
+    for (int iteration = 0; iteration < 1000; iteration++) {
+        double w = weight[high] - weight[low];
+        double m = (moment[high] - moment[low]) / w;
+        sigma = std::sqrt(std::max((moment2[high] - moment2[low]) / w - m * m, 0.0));
+        mean = center + m;
+
+        size_t newLow = std::lower_bound(values.begin(), values.end(), mean - kappa * sigma) - values.begin();
+        size_t newHigh = std::upper_bound(values.begin(), values.end(), mean + kappa * sigma) - values.begin();
+        if ((newLow == low && newHigh == high) || newHigh <= newLow)
+            break;
+        low = newLow;
+        high = newHigh;
+    }
+    return mean + kappa * sigma;
+}
+
+/**
+    Thresholds a grayscale image (8 bits, 16 bits, 32 bits integer or float values) with sigma clipping:
+    the background mean m and standard deviation s are estimated by iteratively rejecting the values
+    further than kappa*s from m. Pixels greater than m + kappa*s are set to 255, the other ones to 0.
+*/
+Mat thresholdSigmaClipping(Mat image, float kappa)
+{
+    CV_Assert(kappa > 0);
+    return thresholdFromHistogram(image, [kappa](const vector<double>& values, const vector<double>& counts) {
+        return sigmaClippingThreshold(values, counts, kappa);
+    });
+}
@@ -2,7 +2,119 @@
 #pragma once
 
 #include <opencv2/opencv.hpp>
+#include <vector>
+#include <deque>
+#include <string>
 
+/**
+    Histogram of an unsigned char image ([0;255]).
+    It is computed once and can then be given to equalize, thresholdOtsu
+    and the other histogram based operators instead of recounting the pixels.
+*/
+class Histogram
+{
+public:
+    static const int numberOfBins = 256;
+
+    Histogram();
+    explicit Histogram(cv::Mat image);
+
+    int operator[](int value) const { return counts[value]; }
+    int total() const { return numberOfPixels; }
+    std::vector<int> cumulative() const;
+
+private:
+    int counts[numberOfBins];
+    int numberOfPixels;
+};
+
+
+/**
+    Histogram specification towards a fixed reference histogram.
+    The cumulative histogram of the reference is computed once, so matching a batch
+    of images only costs the histogram of each image and a lookup table pass.
+*/
+class HistogramMatcher
+{
+public:
+    explicit HistogramMatcher(cv::Mat reference);
+    explicit HistogramMatcher(const Histogram& reference);
+
+    cv::Mat apply(cv::Mat image) const;
+    cv::Mat apply(cv::Mat image, const Histogram& histogram) const;
+
+private:
+    std::vector<int> referenceCumulative;
+    int referenceTotal;
+};
+
+/**
+    Histogram equalization of a sequence of unsigned char frames ([0;255]).
+    The equalizer keeps a running histogram of the last frames, either exponentially
+    decayed or over a sliding window, and only rebuilds its lookup table when the
+    cumulative distribution has drifted by more than a tolerance since the last build.
+*/
+class RunningEqualizer
+{
+public:
+    static RunningEqualizer decayed(float decay=0.9f, float tolerance=0.005f);
+    static RunningEqualizer windowed(int numberOfFrames, float tolerance=0.005f);
+
+    cv::Mat apply(cv::Mat frame);
+    cv::Mat apply(cv::Mat frame, const Histogram& histogram);
+    void reset();
+
+    int numberOfRebuilds() const { return rebuilds; }
+
+private:
+    RunningEqualizer(float decay, int numberOfFrames, float tolerance);
+
+    void update(const Histogram& histogram);
+    void rebuildLut(const std::vector<double>& cumulative, const std::vector<double>& cdf);
+
+    float decay;
+    int numberOfFrames;
+    float tolerance;
+    std::vector<double> counts;
+    double total;
+    std::deque<Histogram> window;
+    std::vector<double> lutCdf;
+    cv::Mat lut;
+    int rebuilds;
+};
+
+/**
+    Sequence of per-pixel operators applied in a single traversal of the image.
+    Each method appends a stage and returns the pipeline so that the stages can be chained:
+        PointPipeline().normalize(0, 1, 0.2f, 0.8f).quantize(4).threshold(0.2f, 0.8f).apply(image)
+*/
+class PointPipeline
+{
+public:
+    PointPipeline& inverse();
+    PointPipeline& threshold(float lowT, float highT);
+    PointPipeline& quantize(int numberOfLevels);
+    PointPipeline& normalize(float inputMin, float inputMax, float minValue=0, float maxValue=1);
+    PointPipeline& gamma(float gamma);
+
+    bool empty() const { return stages.empty(); }
+    float operator()(float value) const;
+
+    cv::Mat apply(cv::Mat image) const;
+    void applyInPlace(cv::Mat image) const;
+
+private:
+    enum StageType { Inverse, Threshold, Quantize, Affine, Gamma };
+    struct Stage
+    {
+        StageType type;
+        float a, b, c;
+        int n;
+    };
+    std::vector<Stage> stages;
+
+    void applySpan(const float* src, float* dst, int length) const;
+};
 
 cv::Mat inverse(cv::Mat image);
 
@@ -10,9 +122,30 @@ cv::Mat threshold(cv::Mat image, float lowT, float highT);
 
 cv::Mat normalize(cv::Mat image,  float minValue=0, float maxValue=1);
 
+void normalizeStreaming(std::string inputFilename, std::string outputFilename, int stripRows, float minValue=0, float maxValue=1);
+
 cv::Mat quantize(cv::Mat image, int numberOfLevels);
 
 cv::Mat equalize(cv::Mat image);
 
+cv::Mat equalize(cv::Mat image, const Histogram& histogram);
+
+cv::Mat matchHistogram(cv::Mat image, cv::Mat reference);
+
+cv::Mat equalizeHighDepth(cv::Mat image, int outputDepth=-1);
+
+cv::Mat equalizeAdaptive(cv::Mat image, int gridSize=8, float clipLimit=2.0f);
+
 cv::Mat thresholdOtsu(cv::Mat image);
 
+cv::Mat thresholdOtsu(cv::Mat image, const Histogram& histogram);
+
+std::vector<int> otsuThresholds(const Histogram& histogram, int numberOfClasses);
+
+cv::Mat thresholdOtsuMulti(cv::Mat image, int numberOfClasses);
+
+cv::Mat thresholdOtsuMulti(cv::Mat image, const Histogram& histogram, int numberOfClasses);
+
+cv::Mat thresholdKMean(cv::Mat image);
+
+cv::Mat thresholdSigmaClipping(cv::Mat image, float kappa=3.0f);